@@ -0,0 +1,70 @@
+#pragma once
+
+#include "double2.hpp"
+#include <cmath>
+#include <cstddef>
+#include <numbers>
+
+
+// normalize an angle in degrees to [0, 360)
+inline double normalizeAngle(double angle) {
+	angle = std::fmod(angle, 360.0);
+	return angle < 0 ? angle + 360.0 : angle + 0.0;
+}
+
+// 2D affine transform (rotation and translation). Angles are in degrees, positive is counter-clockwise as seen on the
+// board where the y axis points down
+struct Affine {
+	// images of the x and y axis and translation
+	double2 x = {1, 0};
+	double2 y = {0, 1};
+	double2 t;
+
+	// rotation around a center
+	static Affine rotation(double angle, double2 center = {}) {
+		double a = angle * std::numbers::pi / 180.0;
+		double c = std::cos(a);
+		double s = std::sin(a);
+		if (std::fmod(angle, 90.0) == 0) {
+			// exact for multiples of 90 degrees
+			c = std::round(c);
+			s = std::round(s);
+		}
+		Affine m;
+		m.x = {c, -s};
+		m.y = {s, c};
+		m.t = center - m.linear(center);
+		return m;
+	}
+
+	bool identity() const {
+		return this->x == double2(1, 0) && this->y == double2(0, 1) && this->t.zero();
+	}
+
+	// rotation angle in degrees
+	double angle() const {
+		return std::atan2(-this->x.y, this->x.x) * 180.0 / std::numbers::pi;
+	}
+
+	// transform a direction (without translation)
+	double2 linear(double2 p) const {
+		return this->x * p.x + this->y * p.y;
+	}
+
+	// transform a point
+	double2 operator ()(double2 p) const {
+		return this->x * p.x + this->y * p.y + this->t;
+	}
+};
+
+// transform contiguous points in place and round them to the KiCad resolution of 1nm. The points are independent of
+// each other so that the compiler can vectorize the loop
+inline void transform(const Affine &m, double2 *points, size_t count) {
+	double xx = m.x.x, xy = m.x.y, yx = m.y.x, yy = m.y.y, tx = m.t.x, ty = m.t.y;
+	for (size_t i = 0; i < count; ++i) {
+		double px = points[i].x;
+		double py = points[i].y;
+		points[i].x = std::nearbyint((xx * px + yx * py + tx) * 1e6) * 1e-6 + 0.0;
+		points[i].y = std::nearbyint((xy * px + yy * py + ty) * 1e6) * 1e-6 + 0.0;
+	}
+}
@@ -0,0 +1,204 @@
+#include "allocstats.hpp"
+
+#ifdef ALLOC_STATS
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <new>
+
+
+namespace {
+
+constexpr int STAGE_COUNT = int(Stage::COUNT);
+constexpr const char *stageNames[] = {"other", "parse", "inherit", "pads", "clipping", "emission", "vrml"};
+
+struct StageCounters {
+	std::atomic<int64_t> count;
+	std::atomic<int64_t> bytes;
+	std::atomic<int64_t> live;
+	std::atomic<int64_t> peak;
+};
+StageCounters stages[STAGE_COUNT];
+
+// live bytes of all stages and their peak
+std::atomic<int64_t> totalLive;
+std::atomic<int64_t> totalPeak;
+
+// call site tags in a fixed size table so that counting does not allocate
+struct TagCounters {
+	std::atomic<const char *> tag;
+	std::atomic<int64_t> count;
+	std::atomic<int64_t> bytes;
+};
+constexpr int TAG_COUNT = 256;
+TagCounters tags[TAG_COUNT];
+
+// current stage and tag of this thread
+thread_local Stage currentStage = Stage::OTHER;
+thread_local const char *currentTag = "untagged";
+
+// counts of this thread, used for per footprint totals
+thread_local AllocCounts threadCounts;
+
+// header in front of each allocation
+struct alignas(16) Header {
+	uint64_t size;
+	uint32_t offset;
+	Stage stage;
+};
+
+void count(const char *tag, Stage stage, size_t size) {
+	// stage
+	auto &s = stages[int(stage)];
+	s.count.fetch_add(1, std::memory_order_relaxed);
+	s.bytes.fetch_add(size, std::memory_order_relaxed);
+	int64_t live = s.live.fetch_add(size, std::memory_order_relaxed) + size;
+	int64_t peak = s.peak.load(std::memory_order_relaxed);
+	while (live > peak && !s.peak.compare_exchange_weak(peak, live, std::memory_order_relaxed));
+	live = totalLive.fetch_add(size, std::memory_order_relaxed) + size;
+	peak = totalPeak.load(std::memory_order_relaxed);
+	while (live > peak && !totalPeak.compare_exchange_weak(peak, live, std::memory_order_relaxed));
+
+	// tag
+	size_t i = (uintptr_t(tag) >> 3) % TAG_COUNT;
+	for (int n = 0; n < TAG_COUNT; ++n, i = (i + 1) % TAG_COUNT) {
+		auto &t = tags[i];
+		const char *expected = nullptr;
+		if (t.tag.load(std::memory_order_relaxed) == tag || t.tag.compare_exchange_strong(expected, tag)
+			|| expected == tag)
+		{
+			t.count.fetch_add(1, std::memory_order_relaxed);
+			t.bytes.fetch_add(size, std::memory_order_relaxed);
+			break;
+		}
+	}
+
+	// thread
+	++threadCounts.count;
+	threadCounts.bytes += size;
+}
+
+void *allocate(size_t size, size_t alignment) {
+	alignment = std::max(alignment, alignof(Header));
+	size_t offset = std::max(sizeof(Header), alignment);
+	char *block = static_cast<char *>(std::malloc(size + offset + alignment));
+	if (block == nullptr)
+		return nullptr;
+
+	// align user pointer and place header in front of it
+	char *ptr = block + offset;
+	ptr += (alignment - uintptr_t(ptr) % alignment) % alignment;
+	auto header = reinterpret_cast<Header *>(ptr) - 1;
+	header->size = size;
+	header->offset = uint32_t(ptr - block);
+	header->stage = currentStage;
+
+	count(currentTag, currentStage, size);
+	return ptr;
+}
+
+void deallocate(void *ptr) {
+	if (ptr == nullptr)
+		return;
+	auto header = static_cast<Header *>(ptr) - 1;
+	stages[int(header->stage)].live.fetch_sub(header->size, std::memory_order_relaxed);
+	totalLive.fetch_sub(header->size, std::memory_order_relaxed);
+	std::free(static_cast<char *>(ptr) - header->offset);
+}
+
+void *allocateOrThrow(size_t size, size_t alignment) {
+	void *ptr = allocate(size, alignment);
+	if (ptr == nullptr)
+		throw std::bad_alloc();
+	return ptr;
+}
+
+} // namespace
+
+
+// global allocator hooks
+
+void *operator new(size_t size) {return allocateOrThrow(size, 0);}
+void *operator new[](size_t size) {return allocateOrThrow(size, 0);}
+void *operator new(size_t size, const std::nothrow_t &) noexcept {return allocate(size, 0);}
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {return allocate(size, 0);}
+void *operator new(size_t size, std::align_val_t alignment) {return allocateOrThrow(size, size_t(alignment));}
+void *operator new[](size_t size, std::align_val_t alignment) {return allocateOrThrow(size, size_t(alignment));}
+void operator delete(void *ptr) noexcept {deallocate(ptr);}
+void operator delete[](void *ptr) noexcept {deallocate(ptr);}
+void operator delete(void *ptr, size_t) noexcept {deallocate(ptr);}
+void operator delete[](void *ptr, size_t) noexcept {deallocate(ptr);}
+void operator delete(void *ptr, std::align_val_t) noexcept {deallocate(ptr);}
+void operator delete[](void *ptr, std::align_val_t) noexcept {deallocate(ptr);}
+void operator delete(void *ptr, size_t, std::align_val_t) noexcept {deallocate(ptr);}
+void operator delete[](void *ptr, size_t, std::align_val_t) noexcept {deallocate(ptr);}
+
+
+// AllocScope
+
+AllocScope::AllocScope(Stage stage, const char *tag) : stage(currentStage), tag(currentTag) {
+	currentStage = stage;
+	currentTag = tag;
+}
+
+AllocScope::~AllocScope() {
+	currentStage = this->stage;
+	currentTag = this->tag;
+}
+
+
+// AllocFootprint
+
+AllocFootprint::AllocFootprint(const char *name) : name(name), start(threadCounts) {
+}
+
+AllocFootprint::~AllocFootprint() {
+	AllocCounts counts = {threadCounts.count - this->start.count, threadCounts.bytes - this->start.bytes};
+	std::cerr << "alloc " << this->name << ": " << counts.count << " allocations, " << counts.bytes << " bytes"
+		<< std::endl;
+}
+
+
+void allocReport(std::ostream &s) {
+	s << std::left << std::setw(12) << "stage" << std::right << std::setw(14) << "allocations" << std::setw(16)
+		<< "bytes" << std::setw(16) << "peak live" << std::endl;
+	for (int i = 0; i < STAGE_COUNT; ++i) {
+		auto &stage = stages[i];
+		s << std::left << std::setw(12) << stageNames[i] << std::right << std::setw(14) << stage.count.load()
+			<< std::setw(16) << stage.bytes.load() << std::setw(16) << stage.peak.load() << std::endl;
+	}
+
+	// top call site tags by number of allocations
+	int indices[TAG_COUNT];
+	int n = 0;
+	for (int i = 0; i < TAG_COUNT; ++i) {
+		if (tags[i].tag.load() != nullptr)
+			indices[n++] = i;
+	}
+	std::sort(indices, indices + n, [](int a, int b) {return tags[a].count.load() > tags[b].count.load();});
+	s << std::endl << std::left << std::setw(24) << "tag" << std::right << std::setw(14) << "allocations"
+		<< std::setw(16) << "bytes" << std::endl;
+	for (int i = 0; i < std::min(n, 20); ++i) {
+		auto &tag = tags[indices[i]];
+		s << std::left << std::setw(24) << tag.tag.load() << std::right << std::setw(14) << tag.count.load()
+			<< std::setw(16) << tag.bytes.load() << std::endl;
+	}
+}
+
+int64_t allocLive() {
+	return totalLive.load();
+}
+
+int64_t allocPeak() {
+	return totalPeak.load();
+}
+
+void allocResetPeak() {
+	totalPeak.store(totalLive.load());
+}
+
+#endif
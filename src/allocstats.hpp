@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+
+
+// pipeline stages for allocation accounting
+enum class Stage : uint8_t {
+	OTHER,
+	PARSE,
+	INHERIT,
+	PADS,
+	CLIPPING,
+	EMISSION,
+	VRML,
+	COUNT
+};
+
+#ifdef ALLOC_STATS
+
+// allocation counters
+struct AllocCounts {
+	int64_t count = 0;
+	int64_t bytes = 0;
+};
+
+// attributes all allocations of the current thread to a stage and a call site tag (string literal) while in scope
+class AllocScope {
+public:
+	AllocScope(Stage stage, const char *tag);
+	~AllocScope();
+
+private:
+	Stage stage;
+	const char *tag;
+};
+
+// counts all allocations of the current thread while in scope and reports them for a footprint
+class AllocFootprint {
+public:
+	AllocFootprint(const char *name);
+	~AllocFootprint();
+
+private:
+	const char *name;
+	AllocCounts start;
+};
+
+// print allocations, bytes and peak live memory per stage and the top call site tags
+void allocReport(std::ostream &s);
+
+// live bytes of all stages
+int64_t allocLive();
+
+// peak of the live bytes of all stages since the last reset
+int64_t allocPeak();
+
+// reset the peak to the current live bytes
+void allocResetPeak();
+
+#define ALLOC_SCOPE(stage, tag) AllocScope allocScope(stage, tag)
+#define ALLOC_FOOTPRINT(name) AllocFootprint allocFootprint(name)
+#define ALLOC_REPORT(s) allocReport(s)
+
+#else
+
+#define ALLOC_SCOPE(stage, tag)
+#define ALLOC_FOOTPRINT(name)
+#define ALLOC_REPORT(s)
+
+#endif
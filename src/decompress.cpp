@@ -0,0 +1,175 @@
+#include "decompress.hpp"
+#include <zlib.h>
+#include <zstd.h>
+#include <fstream>
+#include <stdexcept>
+
+
+namespace {
+
+// istream that owns its stream buffer
+class DecompressStream : public std::istream {
+public:
+	DecompressStream(std::unique_ptr<std::istream> input, DecompressBuffer::Format format)
+		: std::istream(nullptr), buffer(std::move(input), format)
+	{
+		rdbuf(&this->buffer);
+	}
+
+private:
+	DecompressBuffer buffer;
+};
+
+// read a block of compressed input, returns the number of bytes read
+size_t readInput(std::istream &input, char *data, size_t size) {
+	input.read(data, size);
+	return size_t(input.gcount());
+}
+
+} // namespace
+
+
+DecompressBuffer::DecompressBuffer(std::unique_ptr<std::istream> input, Format format)
+	: input(std::move(input)), queue(CHUNK_COUNT)
+{
+	this->thread = std::thread([this, format] {
+		try {
+			if (format == Format::GZIP)
+				inflateGzip();
+			else
+				decompressZstd();
+		} catch (std::exception &e) {
+			this->error = e.what();
+		}
+		this->queue.close();
+	});
+}
+
+DecompressBuffer::~DecompressBuffer() {
+	// let the thread run to the end without decompressing further
+	this->stop.store(true, std::memory_order_relaxed);
+	std::string chunk;
+	while (this->queue.pop(chunk));
+	this->thread.join();
+}
+
+DecompressBuffer::int_type DecompressBuffer::underflow() {
+	if (gptr() < egptr())
+		return traits_type::to_int_type(*gptr());
+
+	// get next chunk from the thread, skip empty chunks
+	do {
+		if (!this->queue.pop(this->chunk)) {
+			if (!this->error.empty())
+				throw std::runtime_error(this->error);
+			return traits_type::eof();
+		}
+	} while (this->chunk.empty());
+	char *data = this->chunk.data();
+	setg(data, data, data + this->chunk.size());
+	return traits_type::to_int_type(*data);
+}
+
+bool DecompressBuffer::emit(std::string &chunk) {
+	if (this->stop.load(std::memory_order_relaxed))
+		return false;
+	this->queue.push(std::move(chunk));
+	chunk.clear();
+	return true;
+}
+
+void DecompressBuffer::inflateGzip() {
+	z_stream z = {};
+	if (inflateInit2(&z, 15 + 16) != Z_OK)
+		throw std::runtime_error("gzip: init failed");
+	std::unique_ptr<z_stream, int (*)(z_stream *)> guard(&z, inflateEnd);
+
+	std::string in(CHUNK_SIZE, 0);
+	std::string out;
+	int result = Z_OK;
+	bool full = false; // the last call filled the output, inflate may hold more output without further input
+	while (true) {
+		if (z.avail_in == 0 && !full) {
+			z.avail_in = uInt(readInput(*this->input, in.data(), in.size()));
+			z.next_in = reinterpret_cast<Bytef *>(in.data());
+			if (z.avail_in == 0)
+				break;
+		}
+
+		// a new member of a concatenated gzip file starts after the end of the previous member
+		if (result == Z_STREAM_END)
+			inflateReset(&z);
+
+		out.resize(CHUNK_SIZE);
+		z.next_out = reinterpret_cast<Bytef *>(out.data());
+		z.avail_out = uInt(out.size());
+		result = inflate(&z, Z_NO_FLUSH);
+		if (result != Z_OK && result != Z_STREAM_END && result != Z_BUF_ERROR)
+			throw std::runtime_error(std::string("gzip: ") + (z.msg != nullptr ? z.msg : "corrupt data"));
+		full = z.avail_out == 0 && result != Z_STREAM_END;
+		out.resize(out.size() - z.avail_out);
+		if (!emit(out))
+			return;
+	}
+	if (result != Z_STREAM_END)
+		throw std::runtime_error("gzip: unexpected end of file");
+}
+
+void DecompressBuffer::decompressZstd() {
+	std::unique_ptr<ZSTD_DStream, size_t (*)(ZSTD_DStream *)> stream(ZSTD_createDStream(), ZSTD_freeDStream);
+	if (stream == nullptr)
+		throw std::runtime_error("zstd: init failed");
+
+	std::string in(ZSTD_DStreamInSize(), 0);
+	std::string out;
+	size_t result = 0;
+	while (true) {
+		ZSTD_inBuffer input = {in.data(), readInput(*this->input, in.data(), in.size()), 0};
+		if (input.size == 0)
+			break;
+		while (input.pos < input.size) {
+			out.resize(CHUNK_SIZE);
+			ZSTD_outBuffer output = {out.data(), out.size(), 0};
+			result = ZSTD_decompressStream(stream.get(), &output, &input);
+			if (ZSTD_isError(result))
+				throw std::runtime_error(std::string("zstd: ") + ZSTD_getErrorName(result));
+			out.resize(output.pos);
+			if (!emit(out))
+				return;
+		}
+	}
+
+	// flush data that is still buffered in the decoder
+	while (result != 0) {
+		out.resize(CHUNK_SIZE);
+		ZSTD_inBuffer input = {nullptr, 0, 0};
+		ZSTD_outBuffer output = {out.data(), out.size(), 0};
+		result = ZSTD_decompressStream(stream.get(), &output, &input);
+		if (ZSTD_isError(result))
+			throw std::runtime_error(std::string("zstd: ") + ZSTD_getErrorName(result));
+		if (output.pos == 0)
+			throw std::runtime_error("zstd: unexpected end of file");
+		out.resize(output.pos);
+		if (!emit(out))
+			return;
+	}
+}
+
+
+std::unique_ptr<std::istream> openInput(const std::filesystem::path &path) {
+	auto file = std::make_unique<std::ifstream>(path.string(), std::ios::binary);
+	if (!file->is_open())
+		return nullptr;
+
+	// detect format by magic number
+	unsigned char magic[4] = {};
+	file->read(reinterpret_cast<char *>(magic), 4);
+	size_t count = size_t(file->gcount());
+	file->clear();
+	file->seekg(0);
+	if (count >= 2 && magic[0] == 0x1f && magic[1] == 0x8b)
+		return std::make_unique<DecompressStream>(std::move(file), DecompressBuffer::Format::GZIP);
+	if (count >= 4 && magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd)
+		return std::make_unique<DecompressStream>(std::move(file), DecompressBuffer::Format::ZSTD);
+	return file;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "queue.hpp"
+#include <atomic>
+#include <filesystem>
+#include <istream>
+#include <memory>
+#include <string>
+#include <thread>
+
+
+// stream buffer that decompresses a gzip or zstd file on a background thread so that decompression overlaps parsing.
+// Errors in the compressed data are thrown as std::runtime_error from the read functions of the stream
+class DecompressBuffer : public std::streambuf {
+public:
+	enum class Format {
+		GZIP,
+		ZSTD,
+	};
+
+	DecompressBuffer(std::unique_ptr<std::istream> input, Format format);
+
+	// stops decompression if the stream was not read to the end
+	~DecompressBuffer() override;
+
+protected:
+	int_type underflow() override;
+
+private:
+	// size of decompressed chunks and number of chunks that can be pending
+	static constexpr size_t CHUNK_SIZE = 256 * 1024;
+	static constexpr size_t CHUNK_COUNT = 8;
+
+	void inflateGzip();
+	void decompressZstd();
+
+	// pass a decompressed chunk to the reader, returns false if the reader has stopped
+	bool emit(std::string &chunk);
+
+	std::unique_ptr<std::istream> input;
+	BoundedQueue<std::string> queue;
+	std::string chunk;
+	std::string error;
+	std::atomic<bool> stop = false;
+	std::thread thread;
+};
+
+// open an input file, gzip and zstd compressed files are detected by their magic number and decompressed while
+// reading. Returns nullptr if the file can't be opened
+std::unique_ptr<std::istream> openInput(const std::filesystem::path &path);
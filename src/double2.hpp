@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cmath>
 #include <iostream>
 
 
@@ -46,6 +47,22 @@ inline double2 operator *(double2 a, double2 b) {
 	return {a.x * b.x, a.y * b.y};
 }
 
+inline bool operator ==(double2 a, double2 b) {
+	return a.x == b.x && a.y == b.y;
+}
+
+inline double dot(double2 a, double2 b) {
+	return a.x * b.x + a.y * b.y;
+}
+
+inline double cross(double2 a, double2 b) {
+	return a.x * b.y - a.y * b.x;
+}
+
+inline double length(double2 a) {
+	return std::sqrt(dot(a, a));
+}
+
 inline std::ostream &operator <<(std::ostream &s, double2 value) {
 	s << value.x << ' ' << value.y;
 	return s;
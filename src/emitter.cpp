@@ -0,0 +1,692 @@
+#include "emitter.hpp"
+#include "writer.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <iomanip>
+#include <numbers>
+
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// check if closed path is an axis aligned rectangle
+bool isRectangle(const std::vector<double2> &points) {
+    if (points.size() != 4)
+        return false;
+    for (int i = 0; i < 4; ++i) {
+        double2 a = points[i];
+        double2 b = points[(i + 1) & 3];
+        if ((a.x == b.x) == (a.y == b.y))
+            return false;
+    }
+    return true;
+}
+
+// get point on arc, rounded to KiCad resolution of 1nm
+double2 arcPoint(double2 center, double radius, double angle) {
+    double2 p = center + double2(std::cos(angle), std::sin(angle)) * radius;
+    return double2(std::round(p.x * 1e6) * 1e-6 + 0.0, std::round(p.y * 1e6) * 1e-6 + 0.0);
+}
+
+// get pad type and shape keywords
+const char *padType(const PadInfo &pad) {
+    if (!pad.size.positive())
+        return "np_thru_hole";
+    return pad.drillSize.positive() ? "thru_hole" : "smd";
+}
+
+const char *padShape(double shape, double2 size) {
+    if (shape <= RECT)
+        return "rect";
+    if (shape >= CIRCLE)
+        return size.x == size.y ? "circle" : "oval";
+    return "roundrect";
+}
+
+// angle of (at x y angle) that is left out if zero
+struct OptionalAngle {
+    double angle;
+};
+
+std::ostream &operator <<(std::ostream &s, OptionalAngle a) {
+    if (a.angle != 0)
+        s << ' ' << a.angle;
+    return s;
+}
+
+void writeDrill(std::ostream &s, const PadInfo &pad) {
+    s << " (drill ";
+    if (pad.drillSize.x == pad.drillSize.y)
+        s << pad.drillSize.x;
+    else
+        s << "oval " << pad.drillSize;
+    if (!pad.padOffset.zero())
+        s << " (offset " << pad.padOffset << ")";
+    s << ")";
+}
+
+// write json string
+void writeString(std::ostream &s, std::string_view str) {
+    s << '"';
+    for (char ch : str) {
+        if (ch == '"' || ch == '\\')
+            s << '\\' << ch;
+        else if (uint8_t(ch) < 0x20)
+            s << "\\u" << std::hex << std::setw(4) << std::setfill('0') << int(ch) << std::dec;
+        else
+            s << ch;
+    }
+    s << '"';
+}
+
+// write text escaped for xml and html content and attribute values
+void writeXml(std::ostream &s, std::string_view str) {
+    for (char ch : str) {
+        switch (ch) {
+        case '&': s << "&amp;"; break;
+        case '<': s << "&lt;"; break;
+        case '>': s << "&gt;"; break;
+        case '"': s << "&quot;"; break;
+        case '\'': s << "&#39;"; break;
+        default: s << ch;
+        }
+    }
+}
+
+// write text percent-encoded for use in a relative url, e.g. a file name containing '#'
+void writeUrl(std::ostream &s, std::string_view str) {
+    const char *hex = "0123456789ABCDEF";
+    for (char ch : str) {
+        uint8_t c = uint8_t(ch);
+        if (std::isalnum(c) || ch == '-' || ch == '.' || ch == '_' || ch == '~')
+            s << ch;
+        else
+            s << '%' << hex[c >> 4] << hex[c & 15];
+    }
+}
+
+// name of the 3D model without extension
+std::string_view modelName(const FootprintInfo &info) {
+    return info.modelName.empty() ? info.name : info.modelName;
+}
+
+// hand buffered output over to the file writer
+void writeFile(const fs::path &file, std::ostringstream &s) {
+    FileWriter::write(file, std::move(s).str());
+}
+
+// 64 bit FNV-1a hash
+uint64_t hash(std::string_view data) {
+    uint64_t h = 14695981039346656037ull;
+    for (char ch : data)
+        h = (h ^ uint8_t(ch)) * 1099511628211ull;
+    return h;
+}
+
+// finalizer of splitmix64
+uint64_t mix(uint64_t x) {
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+// placeholders for ids that get derived from the content when the footprint is complete
+constexpr std::string_view uuidPlaceholder = "00000000-0000-0000-0000-000000000000";
+constexpr std::string_view teditPlaceholder = "00000000";
+
+// replace the placeholders at the offsets recorded while writing by ids derived from a hash of the content and the
+// index of the placeholder. Unchanged footprints get written byte-identical, changed footprints get new ids. The
+// offsets are recorded instead of searched for so that user text such as a description can't be mistaken for an id
+template <typename F>
+void replaceIds(std::string &content, const size_t *offsets, size_t count, size_t size, F format) {
+    uint64_t h = hash(content);
+    char buffer[40];
+    for (size_t i = 0; i < count; ++i) {
+        format(buffer, mix(h + (i + 1) * 0x9e3779b97f4a7c15ull));
+        content.replace(offsets[i], size, buffer, size);
+    }
+}
+
+// write a uuid placeholder and record its offset
+void writeUuid(std::ostringstream &s, std::vector<size_t> &ids) {
+    ids.push_back(size_t(s.tellp()));
+    s << uuidPlaceholder;
+}
+
+// uuid (version 8, i.e. custom) from a 64 bit hash
+void formatUuid(char *buffer, uint64_t h) {
+    uint64_t a = h;
+    uint64_t b = mix(h);
+    a = (a & 0xffffffffffff0fffull) | 0x0000000000008000ull;
+    b = (b & 0x3fffffffffffffffull) | 0x8000000000000000ull;
+    std::snprintf(buffer, 40, "%08x-%04x-%04x-%04x-%012llx", uint32_t(a >> 32), uint32_t(a >> 16) & 0xffff,
+        uint32_t(a) & 0xffff, uint32_t(b >> 48), (unsigned long long)(b & 0xffffffffffffull));
+}
+
+// timestamp of the legacy format from a 64 bit hash
+void formatTedit(char *buffer, uint64_t h) {
+    std::snprintf(buffer, 40, "%08X", uint32_t(h >> 32));
+}
+
+} // namespace
+
+
+// KicadEmitter
+
+void KicadEmitter::begin(const fs::path &dir, const FootprintInfo &info) {
+    std::string name(info.name);
+    this->file = dir / (name + ".kicad_mod");
+    this->s.str({});
+    auto &s = this->s;
+
+    char side = info.back ? 'B' : 'F';
+    const char *justify = info.back ? " (justify mirror)" : "";
+    s << "(module " << name << " (layer " << side << ".Cu) (tedit ";
+    this->tedit = size_t(s.tellp());
+    s << teditPlaceholder << ")" << std::endl;
+    s << "  (descr \"" << info.description << "\")" << std::endl;
+    s << "  (attr " << (info.throughHole ? "through_hole" : "smd") << ')' << std::endl;
+    if (info.model)
+        s << "  (model \"" << modelName(info) << ".wrl\" (at (xyz 0 0 0)) (scale (xyz 1 1 1)) (rotate (xyz 0 0 0)))" << std::endl;
+    s << "  (fp_text reference REF** (at " << info.refPosition << OptionalAngle{info.textAngle} << ") (layer " << side << ".SilkS) (effects (font (size 1 1) (thickness 0.15))" << justify << "))" << std::endl;
+    s << "  (fp_text value " << name << " (at " << info.valuePosition << OptionalAngle{info.textAngle} << ") (layer " << side << ".Fab) (effects (font (size 1 1) (thickness 0.15))" << justify << "))" << std::endl;
+    s << "  (solder_mask_margin " << info.maskMargin << ")" << std::endl;
+    s << "  (solder_paste_margin " << info.pasteMargin << ")" << std::endl;
+}
+
+void KicadEmitter::pad(const PadInfo &pad) {
+    auto &t = this->padTemplates.get(pad, [](const PadInfo &pad, PadTemplate &t) {
+        std::ostringstream s;
+        bool hasPad = pad.size.positive();
+        bool hasDrill = pad.drillSize.positive();
+        double2 size = hasPad ? pad.size : pad.drillSize;
+        double shape = hasPad ? pad.shape : CIRCLE;
+
+        // type and shape
+        s << "\" " << padType(pad) << ' ' << padShape(shape, size);
+        if (shape > RECT && shape < CIRCLE && shape != ROUNDRECT)
+            s << " (roundrect_rratio " << shape << ")";
+        s << " (at ";
+        t.head = std::move(s).str();
+        s.str({});
+
+        // size
+        s << ") (size " << size << ")";
+
+        // drill
+        if (hasDrill)
+            writeDrill(s, pad);
+
+        // margins
+        if (pad.clearance > 0)
+            s << " (clearance " << pad.clearance << ")";
+        if (pad.maskMargin != 0)
+            s << " (solder_mask_margin " << pad.maskMargin << ")";
+
+        // layers
+        const char *layers = hasDrill ? "*.Cu *.Mask" : (pad.back ? "B.Cu B.Mask B.Paste" : "F.Cu F.Mask F.Paste");
+        s << " (layers " << layers << ")";
+        if (hasPad && hasDrill)
+            s << " (remove_unused_layers) (keep_end_layers)";
+        s << ")\n";
+        t.tail = std::move(s).str();
+    });
+
+    // only name and position change within a pad array
+    this->s << "  (pad \"" << (pad.size.positive() ? pad.name : "") << t.head << pad.position
+        << OptionalAngle{pad.angle} << t.tail;
+}
+
+// write stroke, fill (only for closed shapes) and layer
+static void writeStroke(std::ostream &s, double width, std::string_view layer, bool closed = false) {
+    s << " (stroke (width " << width << ") (type solid))";
+    if (closed)
+        s << " (fill none)";
+    s << " (layer \"" << layer << "\")"
+        ")" << std::endl;
+}
+
+void KicadEmitter::path(const std::vector<double2> &points, bool closed, double width, std::string_view layer) {
+    auto &s = this->s;
+    int count = points.size();
+    if (closed && isRectangle(points)) {
+        s << "  (fp_rect (start " << points[0] << ") (end " << points[2] << ")";
+        writeStroke(s, width, layer, true);
+    } else if (closed && count >= 3) {
+        s << "  (fp_poly (pts";
+        for (auto p : points) {
+            s << " (xy " << p << ")";
+        }
+        s << ")";
+        writeStroke(s, width, layer, true);
+    } else {
+        for (int i = 0; i < count - 1; ++i) {
+            s << "  (fp_line (start " << points[i] << ") (end " << points[i + 1] << ")";
+            writeStroke(s, width, layer);
+        }
+    }
+}
+
+void KicadEmitter::arc(double2 center, double radius, double startAngle, double angle, double width,
+    std::string_view layer)
+{
+    this->s << "  (fp_arc"
+        " (start " << arcPoint(center, radius, startAngle) << ")"
+        " (mid " << arcPoint(center, radius, startAngle + angle * 0.5) << ")"
+        " (end " << arcPoint(center, radius, startAngle + angle) << ")";
+    writeStroke(this->s, width, layer);
+}
+
+void KicadEmitter::circle(double2 center, double radius, double width, std::string_view layer) {
+    this->s << "  (fp_circle"
+        " (center " << center << ")"
+        " (end " << center - double2(radius, 0) << ")"
+        " (stroke (width " << width << ") (type default))"
+        " (fill none)"
+        " (layer \"" << layer << "\")"
+        ")" << std::endl;
+}
+
+void KicadEmitter::end() {
+    this->s << ")" << std::endl;
+    std::string content = std::move(this->s).str();
+    replaceIds(content, &this->tedit, 1, teditPlaceholder.size(), formatTedit);
+    FileWriter::write(this->file, std::move(content));
+}
+
+void KicadEmitter::join(const KicadEmitter &chunk) {
+    this->s << chunk.s.view();
+}
+
+
+// Kicad8Emitter
+
+void Kicad8Emitter::begin(const fs::path &dir, const FootprintInfo &info) {
+    std::string name(info.name);
+    auto d = dir / this->directory;
+    if (!this->directory.empty())
+        fs::create_directories(d);
+    this->file = d / (name + ".kicad_mod");
+    this->s.str({});
+    this->ids.clear();
+    auto &s = this->s;
+
+    s << "(footprint \"" << name << "\"" << std::endl;
+    s << "  (version 20240108)" << std::endl;
+    s << "  (generator \"footprint-tool\")" << std::endl;
+    char side = info.back ? 'B' : 'F';
+    const char *justify = info.back ? " (justify mirror)" : "";
+    s << "  (layer \"" << side << ".Cu\")" << std::endl;
+    s << "  (descr \"" << info.description << "\")" << std::endl;
+    s << "  (property \"Reference\" \"REF**\" (at " << info.refPosition << ' ' << info.textAngle << ") (layer \"" << side << ".SilkS\") (uuid \"";
+    writeUuid(s, this->ids);
+    s << "\")"
+        " (effects (font (size 1 1) (thickness 0.15))" << justify << "))" << std::endl;
+    s << "  (property \"Value\" \"" << name << "\" (at " << info.valuePosition << ' ' << info.textAngle << ") (layer \"" << side << ".Fab\") (uuid \"";
+    writeUuid(s, this->ids);
+    s << "\")"
+        " (effects (font (size 1 1) (thickness 0.15))" << justify << "))" << std::endl;
+    s << "  (solder_mask_margin " << info.maskMargin << ")" << std::endl;
+    s << "  (solder_paste_margin " << info.pasteMargin << ")" << std::endl;
+    s << "  (attr " << (info.throughHole ? "through_hole" : "smd") << ')' << std::endl;
+    if (info.model)
+        s << "  (model \"" << modelName(info) << ".wrl\" (offset (xyz 0 0 0)) (scale (xyz 1 1 1)) (rotate (xyz 0 0 0)))" << std::endl;
+}
+
+void Kicad8Emitter::pad(const PadInfo &pad) {
+    auto &t = this->padTemplates.get(pad, [](const PadInfo &pad, PadTemplate &t) {
+        std::ostringstream s;
+        bool hasPad = pad.size.positive();
+        bool hasDrill = pad.drillSize.positive();
+        double2 size = hasPad ? pad.size : pad.drillSize;
+        double shape = hasPad ? pad.shape : CIRCLE;
+
+        // type and shape
+        s << "\" " << padType(pad) << ' ' << padShape(shape, size) << " (at ";
+        t.head = std::move(s).str();
+        s.str({});
+
+        // size
+        s << ") (size " << size << ")";
+
+        // drill
+        if (hasDrill)
+            writeDrill(s, pad);
+
+        // layers
+        const char *layers = hasDrill ? "\"*.Cu\" \"*.Mask\""
+            : (pad.back ? "\"B.Cu\" \"B.Paste\" \"B.Mask\"" : "\"F.Cu\" \"F.Paste\" \"F.Mask\"");
+        s << " (layers " << layers << ")";
+        if (hasPad && hasDrill)
+            s << " (remove_unused_layers no)";
+        if (shape > RECT && shape < CIRCLE)
+            s << " (roundrect_rratio " << shape << ")";
+
+        // margins
+        if (pad.maskMargin != 0)
+            s << " (solder_mask_margin " << pad.maskMargin << ")";
+        if (pad.clearance > 0)
+            s << " (clearance " << pad.clearance << ")";
+        s << " (uuid \"";
+        t.tail = std::move(s).str();
+    });
+
+    // only name and position change within a pad array, the uuid is a placeholder
+    this->s << "  (pad \"" << (pad.size.positive() ? pad.name : "") << t.head << pad.position
+        << OptionalAngle{pad.angle} << t.tail;
+    writeUuid(this->s, this->ids);
+    this->s << "\"))\n";
+}
+
+// write stroke, fill (only for closed shapes), layer and uuid
+static void writeStroke8(std::ostringstream &s, std::vector<size_t> &ids, double width, std::string_view layer,
+    bool closed = false)
+{
+    s << " (stroke (width " << width << ") (type solid))";
+    if (closed)
+        s << " (fill none)";
+    s << " (layer \"" << layer << "\") (uuid \"";
+    writeUuid(s, ids);
+    s << "\"))" << std::endl;
+}
+
+void Kicad8Emitter::path(const std::vector<double2> &points, bool closed, double width, std::string_view layer) {
+    auto &s = this->s;
+    int count = points.size();
+    if (closed && isRectangle(points)) {
+        s << "  (fp_rect (start " << points[0] << ") (end " << points[2] << ")";
+        writeStroke8(s, this->ids, width, layer, true);
+    } else if (closed && count >= 3) {
+        s << "  (fp_poly (pts";
+        for (auto p : points) {
+            s << " (xy " << p << ")";
+        }
+        s << ")";
+        writeStroke8(s, this->ids, width, layer, true);
+    } else {
+        for (int i = 0; i < count - 1; ++i) {
+            s << "  (fp_line (start " << points[i] << ") (end " << points[i + 1] << ")";
+            writeStroke8(s, this->ids, width, layer);
+        }
+    }
+}
+
+void Kicad8Emitter::arc(double2 center, double radius, double startAngle, double angle, double width,
+    std::string_view layer)
+{
+    this->s << "  (fp_arc"
+        " (start " << arcPoint(center, radius, startAngle) << ")"
+        " (mid " << arcPoint(center, radius, startAngle + angle * 0.5) << ")"
+        " (end " << arcPoint(center, radius, startAngle + angle) << ")";
+    writeStroke8(this->s, this->ids, width, layer);
+}
+
+void Kicad8Emitter::circle(double2 center, double radius, double width, std::string_view layer) {
+    this->s << "  (fp_circle"
+        " (center " << center << ")"
+        " (end " << center - double2(radius, 0) << ")";
+    writeStroke8(this->s, this->ids, width, layer, true);
+}
+
+void Kicad8Emitter::end() {
+    this->s << ")" << std::endl;
+    std::string content = std::move(this->s).str();
+    replaceIds(content, this->ids.data(), this->ids.size(), uuidPlaceholder.size(), formatUuid);
+    FileWriter::write(this->file, std::move(content));
+}
+
+void Kicad8Emitter::join(const Kicad8Emitter &chunk) {
+    // offsets of the chunk are relative to its own buffer
+    size_t base = size_t(this->s.tellp());
+    for (size_t id : chunk.ids)
+        this->ids.push_back(base + id);
+    this->s << chunk.s.view();
+}
+
+
+// GeometryEmitter
+
+void GeometryEmitter::begin(const fs::path &dir, const FootprintInfo &info) {
+    std::string name(info.name);
+    this->file = dir / (name + ".geometry.json");
+    this->s.str({});
+    this->pads.str({});
+    this->paths.str({});
+    this->arcs.str({});
+    this->circles.str({});
+
+    auto &s = this->s;
+    s << "{\"name\": ";
+    writeString(s, info.name);
+    s << ", \"description\": ";
+    writeString(s, info.description);
+    s << ", \"type\": \"" << (info.throughHole ? "through hole" : "smd") << "\"";
+}
+
+// separator between array elements
+static std::ostream &next(std::ostringstream &s) {
+    if (s.tellp() > 0)
+        s << ", ";
+    return s;
+}
+
+void GeometryEmitter::pad(const PadInfo &pad) {
+    auto &t = this->padTemplates.get(pad, [](const PadInfo &pad, PadTemplate &t) {
+        std::ostringstream s;
+        s << ", \"type\": \"" << padType(pad) << "\", \"shape\": " << pad.shape << ", \"position\": [";
+        t.head = std::move(s).str();
+        s.str({});
+        s << ", \"size\": [" << pad.size.x << ", " << pad.size.y << "]"
+            << ", \"drillSize\": [" << pad.drillSize.x << ", " << pad.drillSize.y << "]"
+            << ", \"offset\": [" << pad.padOffset.x << ", " << pad.padOffset.y << "]"
+            << ", \"clearance\": " << pad.clearance << ", \"maskMargin\": " << pad.maskMargin
+            << ", \"back\": " << (pad.back ? "true" : "false") << "}";
+        t.tail = std::move(s).str();
+    });
+
+    auto &s = next(this->pads);
+    s << "{\"name\": ";
+    writeString(s, pad.size.positive() ? pad.name : "");
+    s << t.head << pad.position.x << ", " << pad.position.y << "], \"angle\": " << pad.angle << t.tail;
+}
+
+void GeometryEmitter::path(const std::vector<double2> &points, bool closed, double width, std::string_view layer) {
+    auto &s = next(this->paths);
+    s << "{\"layer\": ";
+    writeString(s, layer);
+    s << ", \"width\": " << width << ", \"closed\": " << (closed ? "true" : "false") << ", \"points\": [";
+    for (size_t i = 0; i < points.size(); ++i) {
+        if (i > 0)
+            s << ", ";
+        s << points[i].x << ", " << points[i].y;
+    }
+    s << "]}";
+}
+
+void GeometryEmitter::arc(double2 center, double radius, double startAngle, double angle, double width,
+    std::string_view layer)
+{
+    auto &s = next(this->arcs);
+    s << "{\"layer\": ";
+    writeString(s, layer);
+    s << ", \"width\": " << width << ", \"center\": [" << center.x << ", " << center.y << "]"
+        << ", \"radius\": " << radius
+        << ", \"startAngle\": " << startAngle * 180.0 / std::numbers::pi
+        << ", \"angle\": " << angle * 180.0 / std::numbers::pi << "}";
+}
+
+void GeometryEmitter::circle(double2 center, double radius, double width, std::string_view layer) {
+    auto &s = next(this->circles);
+    s << "{\"layer\": ";
+    writeString(s, layer);
+    s << ", \"width\": " << width << ", \"center\": [" << center.x << ", " << center.y << "]"
+        << ", \"radius\": " << radius << "}";
+}
+
+void GeometryEmitter::end() {
+    auto &s = this->s;
+    s << ", \"pads\": [" << this->pads.str() << "]";
+    s << ", \"paths\": [" << this->paths.str() << "]";
+    s << ", \"arcs\": [" << this->arcs.str() << "]";
+    s << ", \"circles\": [" << this->circles.str() << "]}" << std::endl;
+    writeFile(this->file, s);
+}
+
+void GeometryEmitter::join(const GeometryEmitter &chunk) {
+    if (!chunk.pads.view().empty())
+        next(this->pads) << chunk.pads.view();
+}
+
+
+// SvgEmitter
+
+void SvgEmitter::begin(const fs::path &dir, const FootprintInfo &info) {
+    fs::create_directories(dir / "svg");
+    this->file = dir / "svg" / (std::string(info.name) + ".svg");
+    this->s.str({});
+    this->min = {1e9, 1e9};
+    this->max = {-1e9, -1e9};
+}
+
+void SvgEmitter::include(double2 p, double margin) {
+    this->min.x = std::min(this->min.x, p.x - margin);
+    this->min.y = std::min(this->min.y, p.y - margin);
+    this->max.x = std::max(this->max.x, p.x + margin);
+    this->max.y = std::max(this->max.y, p.y + margin);
+}
+
+// get css class of a layer, e.g. F_SilkS
+static std::string layerClass(std::string_view layer) {
+    std::string c(layer);
+    for (auto &ch : c) {
+        if (ch == '.' || ch == ' ')
+            ch = '_';
+    }
+    return c;
+}
+
+void SvgEmitter::pad(const PadInfo &pad) {
+    auto &s = this->s;
+    bool hasPad = pad.size.positive();
+    bool hasDrill = pad.drillSize.positive();
+
+    // rotated pads are drawn in a group that rotates around the position (svg rotates clockwise)
+    bool rotated = pad.angle != 0;
+    if (rotated)
+        s << "<g transform=\"rotate(" << -pad.angle << ' ' << pad.position.x << ' ' << pad.position.y << ")\">\n";
+
+    // pad
+    if (hasPad) {
+        double2 center = pad.position + pad.padOffset;
+        double2 p = center - pad.size * 0.5;
+        double r = std::min(pad.size.x, pad.size.y) * std::clamp(pad.shape, RECT, CIRCLE);
+        s << "<rect class=\"" << (hasDrill ? "Cu" : (pad.back ? "B_Cu" : "F_Cu")) << "\" x=\"" << p.x << "\" y=\"" << p.y
+            << "\" width=\"" << pad.size.x << "\" height=\"" << pad.size.y << "\" rx=\"" << r << "\"><title>";
+        writeXml(s, pad.name);
+        s << "</title></rect>\n";
+        if (rotated)
+            include(pad.position, length(pad.padOffset) + length(pad.size) * 0.5);
+        else
+            include(center, std::max(pad.size.x, pad.size.y) * 0.5);
+    }
+
+    // drill
+    if (hasDrill) {
+        double2 p = pad.position - pad.drillSize * 0.5;
+        s << "<rect class=\"drill\" x=\"" << p.x << "\" y=\"" << p.y << "\" width=\"" << pad.drillSize.x
+            << "\" height=\"" << pad.drillSize.y << "\" rx=\"" << std::min(pad.drillSize.x, pad.drillSize.y) * 0.5
+            << "\"/>\n";
+        include(pad.position, std::max(pad.drillSize.x, pad.drillSize.y) * 0.5);
+    }
+
+    if (rotated)
+        s << "</g>\n";
+}
+
+void SvgEmitter::path(const std::vector<double2> &points, bool closed, double width, std::string_view layer) {
+    auto &s = this->s;
+    s << '<' << (closed ? "polygon" : "polyline") << " class=\"" << layerClass(layer) << "\" stroke-width=\"" << width
+        << "\" points=\"";
+    for (size_t i = 0; i < points.size(); ++i) {
+        if (i > 0)
+            s << ' ';
+        s << points[i].x << ',' << points[i].y;
+        include(points[i], width * 0.5);
+    }
+    s << "\"/>\n";
+}
+
+void SvgEmitter::arc(double2 center, double radius, double startAngle, double angle, double width,
+    std::string_view layer)
+{
+    auto p1 = arcPoint(center, radius, startAngle);
+    auto p2 = arcPoint(center, radius, startAngle + angle);
+    this->s << "<path class=\"" << layerClass(layer) << "\" stroke-width=\"" << width << "\" d=\"M " << p1.x << ' '
+        << p1.y << " A " << radius << ' ' << radius << " 0 " << (std::abs(angle) > std::numbers::pi ? 1 : 0) << ' '
+        << (angle > 0 ? 1 : 0) << ' ' << p2.x << ' ' << p2.y << "\"/>\n";
+    include(center, radius + width * 0.5);
+}
+
+void SvgEmitter::circle(double2 center, double radius, double width, std::string_view layer) {
+    this->s << "<circle class=\"" << layerClass(layer) << "\" stroke-width=\"" << width << "\" cx=\"" << center.x
+        << "\" cy=\"" << center.y << "\" r=\"" << radius << "\"/>\n";
+    include(center, radius + width * 0.5);
+}
+
+void SvgEmitter::end() {
+    if (this->min.x > this->max.x)
+        this->min = this->max = {};
+
+    // view box with margin
+    double2 p = this->min - double2(0.5, 0.5);
+    double2 size = this->max - this->min + double2(1, 1);
+
+    std::ostringstream f;
+    f << "<svg xmlns=\"http://www.w3.org/2000/svg\" viewBox=\"" << p.x << ' ' << p.y << ' ' << size.x << ' ' << size.y
+        << "\" width=\"" << size.x * 40 << "\" height=\"" << size.y * 40 << "\">\n"
+        "<style>"
+        "rect,polygon,polyline,path,circle{fill:none;stroke:#888}"
+        ".F_Cu{fill:#c83434;stroke:none}.B_Cu{fill:#4d7fc4;stroke:none}.Cu{fill:#c2a34f;stroke:none}"
+        ".drill{fill:#000;stroke:none}"
+        ".F_SilkS{stroke:#f2eda1}.F_Fab{stroke:#afafaf}.F_CrtYd{stroke:#ff26e2}"
+        ".B_SilkS{stroke:#e8b2a7}.B_Fab{stroke:#585d84}.B_CrtYd{stroke:#26e9ff}"
+        "polyline,path{stroke-linecap:round;stroke-linejoin:round}"
+        "</style>\n"
+        "<rect x=\"" << p.x << "\" y=\"" << p.y << "\" width=\"" << size.x << "\" height=\"" << size.y
+        << "\" style=\"fill:#001023;stroke:none\"/>\n"
+        << this->s.view() << "</svg>\n";
+    writeFile(this->file, f);
+}
+
+void SvgEmitter::join(const SvgEmitter &chunk) {
+    this->s << chunk.s.view();
+    if (chunk.min.x <= chunk.max.x) {
+        include(chunk.min, 0);
+        include(chunk.max, 0);
+    }
+}
+
+void SvgEmitter::writeIndex(const fs::path &dir, const std::vector<std::string> &names) {
+    std::ostringstream s;
+    s << "<!DOCTYPE html>\n<html>\n<head>\n<meta charset=\"utf-8\">\n<title>Footprints</title>\n<style>\n"
+        "body{background:#222;color:#ddd;font-family:sans-serif}\n"
+        "div{display:flex;flex-wrap:wrap;gap:8px}\n"
+        "figure{margin:0;width:200px;text-align:center}\n"
+        "img{width:200px;height:200px;object-fit:contain;background:#001023}\n"
+        "figcaption{font-size:12px;overflow-wrap:anywhere}\n"
+        "</style>\n</head>\n<body>\n<div>\n";
+    for (auto &name : names) {
+        s << "<figure><a href=\"";
+        writeUrl(s, name);
+        s << ".svg\"><img src=\"";
+        writeUrl(s, name);
+        s << ".svg\" loading=\"lazy\"></a><figcaption>";
+        writeXml(s, name);
+        s << "</figcaption></figure>\n";
+    }
+    s << "</div>\n</body>\n</html>\n";
+    writeFile(dir / "svg" / "index.html", s);
+}
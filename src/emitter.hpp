@@ -0,0 +1,429 @@
+#pragma once
+
+#include "affine.hpp"
+#include "double2.hpp"
+#include <algorithm>
+#include <concepts>
+#include <filesystem>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+
+// shapes
+constexpr double CIRCLE = 0.5; // oval if width not equal to height
+constexpr double ROUNDRECT = 0.25; // 25% (KiCad default)
+constexpr double ROUNDRECT10 = 0.1; // 10%
+constexpr double ROUNDRECT5 = 0.05; // 5%
+constexpr double RECT = 0;
+
+
+// general information about a footprint, passed to the emitters at the beginning
+struct FootprintInfo {
+	std::string_view name;
+	std::string_view description;
+	bool throughHole;
+
+	// true if a 3D model gets generated
+	bool model;
+
+	double2 refPosition;
+	double2 valuePosition;
+	double maskMargin;
+	double pasteMargin;
+
+	// rotation of reference and value texts in degrees
+	double textAngle = 0;
+
+	// footprint is placed on the back side
+	bool back = false;
+
+	// name of the 3D model if it is not the name of the footprint
+	std::string_view modelName = {};
+};
+
+// a single pad
+struct PadInfo {
+	std::string_view name;
+	double2 position;
+	double2 size;
+	double shape;
+	double2 drillSize;
+	double2 padOffset;
+	double clearance;
+	double maskMargin;
+	bool back;
+
+	// rotation in degrees around the position, padOffset is relative to the rotated pad
+	double angle = 0;
+};
+
+// pre-rendered constant part of a pad, i.e. everything except name and position. The text before the position is the
+// head and the text after it is the tail
+struct PadTemplate {
+	std::string head;
+	std::string tail;
+};
+
+// cache of pad templates of an emitter. Pads of an array only differ in name and position, therefore the template
+// gets rendered once per array. The last few variants are kept, e.g. the four rotations of a quad
+class PadTemplates {
+public:
+	// get the template for a pad, render(pad, template) gets called if no variant matches
+	template <typename F>
+	const PadTemplate &get(const PadInfo &pad, F render) {
+		for (int i = 0; i < this->count; ++i) {
+			auto &entry = this->entries[i];
+			if (same(entry.pad, pad))
+				return entry.t;
+		}
+
+		// replace oldest variant
+		auto &entry = this->entries[this->next];
+		this->next = (this->next + 1) % SIZE;
+		this->count = std::max(this->count, this->next == 0 ? SIZE : this->next);
+		entry.pad = pad;
+		entry.pad.name = {};
+		entry.t.head.clear();
+		entry.t.tail.clear();
+		render(pad, entry.t);
+		return entry.t;
+	}
+
+protected:
+	static constexpr int SIZE = 4;
+
+	static bool same(const PadInfo &a, const PadInfo &b) {
+		return a.size == b.size && a.shape == b.shape && a.drillSize == b.drillSize && a.padOffset == b.padOffset
+			&& a.clearance == b.clearance && a.maskMargin == b.maskMargin && a.back == b.back;
+	}
+
+	struct Entry {
+		PadInfo pad;
+		PadTemplate t;
+	};
+
+	Entry entries[SIZE];
+	int count = 0;
+	int next = 0;
+};
+
+
+// interface of an output format. The geometry is calculated once and passed to all enabled emitters. Paths are
+// already simplified, angles are in radians. Large footprints emit pads into copies of the emitter (chunks) in
+// parallel which then get joined in order
+template <typename E>
+concept Emitter = requires(E e, const E &chunk, const std::filesystem::path &dir, const FootprintInfo &info,
+	const PadInfo &pad, const std::vector<double2> &points, double2 p, double d, bool b, std::string_view layer)
+{
+	{e.enabled} -> std::convertible_to<bool>;
+	e.begin(dir, info);
+	e.pad(pad);
+	e.path(points, b, d, layer);
+	e.arc(p, d, d, d, d, layer);
+	e.circle(p, d, d, layer);
+	e.end();
+	e.join(chunk);
+};
+
+
+// KiCad legacy format (module ...)
+class KicadEmitter {
+public:
+	KicadEmitter() = default;
+
+	// copy only the settings, e.g. for use in another thread
+	KicadEmitter(const KicadEmitter &other) : enabled(other.enabled) {}
+
+	bool enabled = true;
+
+	void begin(const std::filesystem::path &dir, const FootprintInfo &info);
+	void pad(const PadInfo &pad);
+	void path(const std::vector<double2> &points, bool closed, double width, std::string_view layer);
+	void arc(double2 center, double radius, double startAngle, double angle, double width, std::string_view layer);
+	void circle(double2 center, double radius, double width, std::string_view layer);
+	void end();
+
+	// append pads of a chunk
+	void join(const KicadEmitter &chunk);
+
+protected:
+	std::filesystem::path file;
+	std::ostringstream s;
+	PadTemplates padTemplates;
+
+	// offset of the tedit placeholder
+	size_t tedit = 0;
+};
+
+// KiCad 8 format (footprint ...) with uuids
+class Kicad8Emitter {
+public:
+	Kicad8Emitter() = default;
+
+	// copy only the settings, e.g. for use in another thread
+	Kicad8Emitter(const Kicad8Emitter &other) : enabled(other.enabled), directory(other.directory) {}
+
+	bool enabled = false;
+
+	// directory relative to the output directory, used when the legacy format is written too
+	std::filesystem::path directory;
+
+	void begin(const std::filesystem::path &dir, const FootprintInfo &info);
+	void pad(const PadInfo &pad);
+	void path(const std::vector<double2> &points, bool closed, double width, std::string_view layer);
+	void arc(double2 center, double radius, double startAngle, double angle, double width, std::string_view layer);
+	void circle(double2 center, double radius, double width, std::string_view layer);
+	void end();
+
+	// append pads of a chunk
+	void join(const Kicad8Emitter &chunk);
+
+protected:
+	std::filesystem::path file;
+	std::ostringstream s;
+	PadTemplates padTemplates;
+
+	// offsets of the uuid placeholders
+	std::vector<size_t> ids;
+};
+
+// machine readable geometry as json (name.geometry.json)
+class GeometryEmitter {
+public:
+	GeometryEmitter() = default;
+
+	// copy only the settings, e.g. for use in another thread
+	GeometryEmitter(const GeometryEmitter &other) : enabled(other.enabled) {}
+
+	bool enabled = false;
+
+	void begin(const std::filesystem::path &dir, const FootprintInfo &info);
+	void pad(const PadInfo &pad);
+	void path(const std::vector<double2> &points, bool closed, double width, std::string_view layer);
+	void arc(double2 center, double radius, double startAngle, double angle, double width, std::string_view layer);
+	void circle(double2 center, double radius, double width, std::string_view layer);
+	void end();
+
+	// append pads of a chunk
+	void join(const GeometryEmitter &chunk);
+
+protected:
+	std::filesystem::path file;
+	std::ostringstream s;
+	std::ostringstream pads;
+	std::ostringstream paths;
+	std::ostringstream arcs;
+	std::ostringstream circles;
+	PadTemplates padTemplates;
+};
+
+
+// svg preview of pads, silkscreen, fab and courtyard layers (svg/name.svg)
+class SvgEmitter {
+public:
+	SvgEmitter() = default;
+
+	// copy only the settings, e.g. for use in another thread
+	SvgEmitter(const SvgEmitter &other) : enabled(other.enabled) {}
+
+	bool enabled = false;
+
+	void begin(const std::filesystem::path &dir, const FootprintInfo &info);
+	void pad(const PadInfo &pad);
+	void path(const std::vector<double2> &points, bool closed, double width, std::string_view layer);
+	void arc(double2 center, double radius, double startAngle, double angle, double width, std::string_view layer);
+	void circle(double2 center, double radius, double width, std::string_view layer);
+	void end();
+
+	// append pads of a chunk
+	void join(const SvgEmitter &chunk);
+
+	// write html contact sheet that shows the svg files of all given footprints
+	static void writeIndex(const std::filesystem::path &dir, const std::vector<std::string> &names);
+
+protected:
+	void include(double2 p, double margin);
+
+	std::filesystem::path file;
+	std::ostringstream s;
+	double2 min = {1e9, 1e9};
+	double2 max = {-1e9, -1e9};
+};
+
+
+// layer on the other side of the board, e.g. F.SilkS for B.SilkS. Layers of both sides (*.Cu) stay the same
+inline std::string flipLayer(std::string_view layer) {
+	std::string flipped(layer);
+	if (flipped.starts_with("F."))
+		flipped[0] = 'B';
+	else if (flipped.starts_with("B."))
+		flipped[0] = 'F';
+	return flipped;
+}
+
+
+// set of emitters chosen at compile time, each one can be enabled at runtime. All geometry passes through an affine
+// transform stage before it reaches the emitters, e.g. for the rotation of the footprint. Optionally a back side
+// variant gets emitted from the same geometry into a second set of emitters, mirrored at the y axis and with swapped
+// layers
+template <Emitter... E>
+class Emitters {
+public:
+	template <typename T>
+	T &get() {return std::get<T>(this->emitters);}
+
+	// set transform that gets applied to all following output
+	void setTransform(const Affine &transform) {
+		this->transform = transform;
+		this->identity = transform.identity();
+		this->angle = transform.angle();
+	}
+
+	// also emit a back side variant with the given name, call before begin()
+	void setBackVariant(std::string name) {
+		this->backName = std::move(name);
+		this->backEmitters.emplace(this->emitters);
+	}
+
+	void begin(const std::filesystem::path &dir, const FootprintInfo &info) {
+		FootprintInfo i = info;
+		if (!this->identity) {
+			double2 positions[] = {i.refPosition, i.valuePosition};
+			::transform(this->transform, positions, 2);
+			i.refPosition = positions[0];
+			i.valuePosition = positions[1];
+			i.textAngle = normalizeAngle(i.textAngle + this->angle);
+		}
+		forEach(this->emitters, [&](auto &e) {e.begin(dir, i);});
+
+		// back side variant uses the 3D model of the front side, KiCad flips it together with the footprint
+		if (back()) {
+			i.name = this->backName;
+			i.modelName = info.name;
+			i.back = !i.back;
+			i.refPosition = mirror(i.refPosition);
+			i.valuePosition = mirror(i.valuePosition);
+			i.textAngle = normalizeAngle(-i.textAngle);
+			forEach(*this->backEmitters, [&](auto &e) {e.begin(dir, i);});
+		}
+	}
+
+	void pad(const PadInfo &pad) {
+		pads(&pad, 1);
+	}
+
+	// emit consecutive pads, the positions are transformed in one batch
+	void pads(const PadInfo *pads, size_t count) {
+		if (!this->identity) {
+			this->points.resize(count);
+			for (size_t i = 0; i < count; ++i)
+				this->points[i] = pads[i].position;
+			::transform(this->transform, this->points.data(), count);
+		}
+		for (size_t i = 0; i < count; ++i) {
+			PadInfo p = pads[i];
+			if (!this->identity) {
+				p.position = this->points[i];
+				p.angle = normalizeAngle(p.angle + this->angle);
+			}
+			forEach(this->emitters, [&](auto &e) {e.pad(p);});
+
+			if (back()) {
+				p.position = mirror(p.position);
+				p.padOffset.x = -p.padOffset.x + 0.0;
+				p.angle = normalizeAngle(-p.angle);
+				p.back = !p.back;
+				forEach(*this->backEmitters, [&](auto &e) {e.pad(p);});
+			}
+		}
+	}
+
+	void path(const std::vector<double2> &points, bool closed, double width, std::string_view layer) {
+		const std::vector<double2> *p = &points;
+		if (!this->identity) {
+			this->points.assign(points.begin(), points.end());
+			::transform(this->transform, this->points.data(), this->points.size());
+			p = &this->points;
+		}
+		forEach(this->emitters, [&](auto &e) {e.path(*p, closed, width, layer);});
+
+		if (back()) {
+			if (p != &this->points)
+				this->points.assign(points.begin(), points.end());
+			for (auto &point : this->points)
+				point = mirror(point);
+			auto backLayer = flipLayer(layer);
+			forEach(*this->backEmitters, [&](auto &e) {e.path(this->points, closed, width, backLayer);});
+		}
+	}
+
+	void arc(double2 center, double radius, double startAngle, double angle, double width, std::string_view layer) {
+		if (!this->identity) {
+			::transform(this->transform, &center, 1);
+			startAngle -= this->angle * std::numbers::pi / 180.0;
+		}
+		forEach(this->emitters, [&](auto &e) {e.arc(center, radius, startAngle, angle, width, layer);});
+
+		// mirroring reverses the direction, therefore the mirrored end becomes the start
+		if (back()) {
+			center = mirror(center);
+			startAngle = std::numbers::pi - startAngle - angle;
+			auto backLayer = flipLayer(layer);
+			forEach(*this->backEmitters, [&](auto &e) {e.arc(center, radius, startAngle, angle, width, backLayer);});
+		}
+	}
+
+	void circle(double2 center, double radius, double width, std::string_view layer) {
+		if (!this->identity)
+			::transform(this->transform, &center, 1);
+		forEach(this->emitters, [&](auto &e) {e.circle(center, radius, width, layer);});
+
+		if (back()) {
+			center = mirror(center);
+			auto backLayer = flipLayer(layer);
+			forEach(*this->backEmitters, [&](auto &e) {e.circle(center, radius, width, backLayer);});
+		}
+	}
+
+	void end() {
+		forEach(this->emitters, [&](auto &e) {e.end();});
+		if (back())
+			forEach(*this->backEmitters, [&](auto &e) {e.end();});
+	}
+
+	// append pads of a chunk that was copied from this
+	void join(const Emitters &chunk) {
+		joinEach(this->emitters, chunk.emitters, std::index_sequence_for<E...>());
+		if (back())
+			joinEach(*this->backEmitters, *chunk.backEmitters, std::index_sequence_for<E...>());
+	}
+
+protected:
+	bool back() const {return this->backEmitters.has_value();}
+
+	// mirror at the y axis
+	static double2 mirror(double2 p) {return {-p.x + 0.0, p.y};}
+
+	template <typename F>
+	static void forEach(std::tuple<E...> &emitters, F function) {
+		std::apply([&](auto &...e) {((e.enabled ? function(e) : void()), ...);}, emitters);
+	}
+
+	template <size_t... I>
+	static void joinEach(std::tuple<E...> &emitters, const std::tuple<E...> &chunk, std::index_sequence<I...>) {
+		((std::get<I>(emitters).enabled ? std::get<I>(emitters).join(std::get<I>(chunk)) : void()), ...);
+	}
+
+	std::tuple<E...> emitters;
+	std::optional<std::tuple<E...>> backEmitters;
+	std::string backName;
+	Affine transform;
+	bool identity = true;
+	double angle = 0;
+	std::vector<double2> points;
+};
@@ -0,0 +1,234 @@
+#include "expression.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <unordered_map>
+
+
+namespace {
+
+constexpr int maxStack = 32;
+
+// parameters of the current thread
+thread_local const Parameters *currentParameters = nullptr;
+
+void skipSpace(std::string_view text, size_t &i) {
+	while (i < text.size() && std::isspace(uint8_t(text[i])))
+		++i;
+}
+
+bool isIdentifier(char ch, bool first) {
+	return std::isalpha(uint8_t(ch)) || ch == '_' || (!first && std::isdigit(uint8_t(ch)));
+}
+
+std::runtime_error syntaxError(std::string_view text, size_t i, const char *message) {
+	return std::runtime_error("expression '" + std::string(text) + "' at " + std::to_string(i) + ": " + message);
+}
+
+} // namespace
+
+
+// Parameters
+
+const double *Parameters::find(std::string_view name) const {
+	for (auto &p : this->values) {
+		if (p.first == name)
+			return &p.second;
+	}
+	return nullptr;
+}
+
+void Parameters::set(std::string_view name, double value) {
+	for (auto &p : this->values) {
+		if (p.first == name) {
+			p.second = value;
+			return;
+		}
+	}
+	this->values.emplace_back(name, value);
+}
+
+
+// Expression
+
+Expression::Expression(std::string_view text) {
+	size_t i = 0;
+	parseSum(text, i, 0);
+	skipSpace(text, i);
+	if (i < text.size())
+		throw syntaxError(text, i, "unexpected character");
+}
+
+double Expression::evaluate(const Parameters &parameters) const {
+	double stack[maxStack];
+	int top = 0;
+	for (auto instruction : this->code) {
+		switch (instruction.op) {
+		case Op::CONSTANT:
+			stack[top++] = this->constants[instruction.index];
+			break;
+		case Op::PARAMETER: {
+			auto &name = this->parameters[instruction.index];
+			auto value = parameters.find(name);
+			if (value == nullptr)
+				throw std::runtime_error("unknown parameter '" + name + "'");
+			stack[top++] = *value;
+			break;
+		}
+		case Op::ADD:
+			--top;
+			stack[top - 1] += stack[top];
+			break;
+		case Op::SUB:
+			--top;
+			stack[top - 1] -= stack[top];
+			break;
+		case Op::MUL:
+			--top;
+			stack[top - 1] *= stack[top];
+			break;
+		case Op::DIV:
+			--top;
+			stack[top - 1] /= stack[top];
+			break;
+		case Op::NEG:
+			stack[top - 1] = -stack[top - 1];
+			break;
+		}
+	}
+	return stack[0];
+}
+
+// sum := product (('+' | '-') product)*
+void Expression::parseSum(std::string_view text, size_t &i, int depth) {
+	parseProduct(text, i, depth);
+	while (true) {
+		skipSpace(text, i);
+		if (i >= text.size() || (text[i] != '+' && text[i] != '-'))
+			break;
+		Op op = text[i++] == '+' ? Op::ADD : Op::SUB;
+		parseProduct(text, i, depth);
+		emit(op);
+	}
+}
+
+// product := unary (('*' | '/') unary)*
+void Expression::parseProduct(std::string_view text, size_t &i, int depth) {
+	parseUnary(text, i, depth);
+	while (true) {
+		skipSpace(text, i);
+		if (i >= text.size() || (text[i] != '*' && text[i] != '/'))
+			break;
+		Op op = text[i++] == '*' ? Op::MUL : Op::DIV;
+		parseUnary(text, i, depth);
+		emit(op);
+	}
+}
+
+// unary := ('-' | '+') unary | number | parameter | '(' sum ')'
+void Expression::parseUnary(std::string_view text, size_t &i, int depth) {
+	if (depth > maxStack)
+		throw syntaxError(text, i, "nested too deep");
+	skipSpace(text, i);
+	if (i >= text.size())
+		throw syntaxError(text, i, "unexpected end");
+
+	char ch = text[i];
+	if (ch == '-' || ch == '+') {
+		++i;
+		parseUnary(text, i, depth + 1);
+		if (ch == '-')
+			emit(Op::NEG);
+	} else if (ch == '(') {
+		++i;
+		parseSum(text, i, depth + 1);
+		skipSpace(text, i);
+		if (i >= text.size() || text[i] != ')')
+			throw syntaxError(text, i, "missing )");
+		++i;
+	} else if (std::isdigit(uint8_t(ch)) || ch == '.') {
+		// parse number (text is not null terminated, therefore copy)
+		size_t start = i;
+		while (i < text.size() && (std::isalnum(uint8_t(text[i])) || text[i] == '.'
+			|| ((text[i] == '-' || text[i] == '+') && (text[i - 1] == 'e' || text[i - 1] == 'E'))))
+		{
+			++i;
+		}
+		std::string number(text.substr(start, i - start));
+		char *end;
+		double value = std::strtod(number.c_str(), &end);
+		if (end != number.c_str() + number.size())
+			throw syntaxError(text, start, "invalid number");
+		this->constants.push_back(value);
+		emit(Op::CONSTANT, this->constants.size() - 1);
+	} else if (isIdentifier(ch, true)) {
+		// parameter
+		size_t start = i;
+		while (i < text.size() && isIdentifier(text[i], false))
+			++i;
+		std::string_view name = text.substr(start, i - start);
+		size_t index = 0;
+		while (index < this->parameters.size() && this->parameters[index] != name)
+			++index;
+		if (index == this->parameters.size())
+			this->parameters.emplace_back(name);
+		emit(Op::PARAMETER, index);
+	} else {
+		throw syntaxError(text, i, "unexpected character");
+	}
+}
+
+void Expression::emit(Op op, size_t index) {
+	// constants and parameters are referenced by 16 bit indices
+	if (index > std::numeric_limits<uint16_t>::max())
+		throw std::runtime_error("expression too complex");
+
+	// track stack size so that evaluation can use a fixed size stack
+	if (op == Op::CONSTANT || op == Op::PARAMETER)
+		++this->stackSize;
+	else if (op != Op::NEG)
+		--this->stackSize;
+	this->maxStackSize = std::max(this->maxStackSize, this->stackSize);
+	if (this->maxStackSize > maxStack)
+		throw std::runtime_error("expression too complex");
+	this->code.push_back({op, uint16_t(index)});
+}
+
+const Expression &getExpression(const std::string &text) {
+	static std::unordered_map<std::string, std::unique_ptr<Expression>> cache;
+	static std::shared_mutex mutex;
+
+	// lookup with shared lock as most expressions are already compiled
+	{
+		std::shared_lock lock(mutex);
+		auto it = cache.find(text);
+		if (it != cache.end())
+			return *it->second;
+	}
+
+	// compile outside of the lock, throws on syntax errors
+	auto expression = std::make_unique<Expression>(text);
+	std::unique_lock lock(mutex);
+	return *cache.try_emplace(text, std::move(expression)).first->second;
+}
+
+
+// ParameterScope
+
+ParameterScope::ParameterScope(const Parameters &parameters) : previous(currentParameters) {
+	currentParameters = &parameters;
+}
+
+ParameterScope::~ParameterScope() {
+	currentParameters = this->previous;
+}
+
+double evaluate(const std::string &text) {
+	static const Parameters none;
+	return getExpression(text).evaluate(currentParameters != nullptr ? *currentParameters : none);
+}
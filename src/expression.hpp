@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+// named parameters of a footprint, inherited from the parent footprint
+class Parameters {
+public:
+	// get value of a parameter, nullptr if not defined
+	const double *find(std::string_view name) const;
+
+	// set a parameter, overrides an existing parameter with the same name
+	void set(std::string_view name, double value);
+
+	bool empty() const {return this->values.empty();}
+
+private:
+	std::vector<std::pair<std::string, double>> values;
+};
+
+
+// arithmetic expression with + - * / and parentheses on numbers and parameters, compiled to bytecode for a small
+// stack machine
+class Expression {
+public:
+	// compile an expression, throws std::runtime_error on syntax errors
+	explicit Expression(std::string_view text);
+
+	// names of the parameters used by the expression
+	const std::vector<std::string> &names() const {return this->parameters;}
+
+	// evaluate the expression, throws std::runtime_error if a parameter is not defined
+	double evaluate(const Parameters &parameters) const;
+
+protected:
+	enum class Op : uint8_t {
+		CONSTANT,
+		PARAMETER,
+		ADD,
+		SUB,
+		MUL,
+		DIV,
+		NEG,
+	};
+
+	struct Instruction {
+		Op op;
+		uint16_t index;
+	};
+
+	void parseSum(std::string_view text, size_t &i, int depth);
+	void parseProduct(std::string_view text, size_t &i, int depth);
+	void parseUnary(std::string_view text, size_t &i, int depth);
+	void emit(Op op, size_t index = 0);
+
+	std::vector<Instruction> code;
+	std::vector<double> constants;
+	std::vector<std::string> parameters;
+	int stackSize = 0;
+	int maxStackSize = 0;
+};
+
+// get a compiled expression, each distinct text gets compiled once per run
+const Expression &getExpression(const std::string &text);
+
+
+// makes parameters available to expressions in json values of the current thread while in scope
+class ParameterScope {
+public:
+	explicit ParameterScope(const Parameters &parameters);
+	~ParameterScope();
+
+private:
+	const Parameters *previous;
+};
+
+// evaluate an expression with the parameters of the current scope
+double evaluate(const std::string &text);
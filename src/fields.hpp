@@ -0,0 +1,154 @@
+#pragma once
+
+#include "double2.hpp"
+#include "double3.hpp"
+#include "expression.hpp"
+#include <nlohmann/json.hpp>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+
+// decoding of json objects into structs using compile-time field tables. Each object is iterated once and the keys
+// are dispatched through a perfect hash
+
+// field of a struct with its json key and a decoder that reads the json value into the struct
+template <typename T>
+struct Field {
+	std::string_view name;
+	void (*decode)(const nlohmann::json &value, T &object);
+};
+
+
+// value decoders, numbers can also be given as expression strings with parameters (see expression.hpp)
+
+inline void decodeValue(const nlohmann::json &value, std::string &v) {v = value.get<std::string>();}
+inline void decodeValue(const nlohmann::json &value, bool &v) {v = value.get<bool>();}
+
+inline void decodeValue(const nlohmann::json &value, double &v) {
+	if (value.is_string())
+		v = evaluate(value.get_ref<const std::string &>());
+	else
+		v = value.get<double>();
+}
+
+inline void decodeValue(const nlohmann::json &value, int &v) {
+	if (value.is_string())
+		v = int(std::lround(evaluate(value.get_ref<const std::string &>())));
+	else
+		v = value.get<int>();
+}
+
+inline void decodeValue(const nlohmann::json &value, double2 &v) {
+	decodeValue(value.at(0), v.x);
+	decodeValue(value.at(1), v.y);
+}
+
+inline void decodeValue(const nlohmann::json &value, double3 &v) {
+	decodeValue(value.at(0), v.x);
+	decodeValue(value.at(1), v.y);
+	decodeValue(value.at(2), v.z);
+}
+
+// number or expression for both components or array with one or two elements
+inline void decodeRelaxed(const nlohmann::json &value, double2 &v) {
+	if (value.is_number() || value.is_string()) {
+		decodeValue(value, v.x);
+		v.y = v.x;
+	} else if (value.is_array()) {
+		decodeValue(value.at(0), v.x);
+		if (value.size() >= 2)
+			decodeValue(value.at(1), v.y);
+		else
+			v.y = v.x;
+	}
+}
+
+// decode into a member, e.g. {"position", decodeMember<&Pad::position>}
+template <auto member, typename T>
+void decodeMember(const nlohmann::json &value, T &object) {
+	decodeValue(value, object.*member);
+}
+
+template <auto member, typename T>
+void decodeRelaxedMember(const nlohmann::json &value, T &object) {
+	decodeRelaxed(value, object.*member);
+}
+
+
+// table of fields with a perfect hash of the names, built at compile time
+template <typename T, size_t N>
+class FieldTable {
+public:
+	static_assert(N <= 64, "field set is returned as 64 bit mask");
+
+	consteval FieldTable(const Field<T> (&fields)[N]) {
+		for (int i = 0; i < int(N); ++i)
+			this->fields[i] = fields[i];
+
+		// search a seed that maps all names to different slots
+		for (this->seed = 1; !tryBuild(); ++this->seed);
+	}
+
+	// get index of a field, -1 if not found
+	constexpr int find(std::string_view name) const {
+		int index = this->slots[hash(name, this->seed) & (SLOT_COUNT - 1)];
+		return index != -1 && this->fields[index].name == name ? index : -1;
+	}
+
+	// get bit of a field in the set of decoded fields, an unknown name fails to compile
+	consteval uint64_t bit(std::string_view name) const {
+		int index = find(name);
+		if (index == -1)
+			throw "unknown field";
+		return uint64_t(1) << index;
+	}
+
+	// decode all known keys of a json object, unknown keys are ignored. Returns the set of decoded fields
+	uint64_t decode(const nlohmann::json &j, T &object) const {
+		uint64_t decoded = 0;
+		for (auto it = j.begin(); it != j.end(); ++it) {
+			int index = find(it.key());
+			if (index != -1) {
+				this->fields[index].decode(it.value(), object);
+				decoded |= uint64_t(1) << index;
+			}
+		}
+		return decoded;
+	}
+
+private:
+	static constexpr size_t SLOT_COUNT = std::bit_ceil(N * 4);
+
+	// FNV-1a with seed
+	static constexpr uint32_t hash(std::string_view name, uint32_t seed) {
+		uint32_t h = 2166136261u ^ seed;
+		for (char ch : name)
+			h = (h ^ uint8_t(ch)) * 16777619u;
+		return h ^ (h >> 15);
+	}
+
+	constexpr bool tryBuild() {
+		this->slots.fill(-1);
+		for (int i = 0; i < int(N); ++i) {
+			auto &slot = this->slots[hash(this->fields[i].name, this->seed) & (SLOT_COUNT - 1)];
+			if (slot != -1)
+				return false;
+			slot = int8_t(i);
+		}
+		return true;
+	}
+
+	std::array<Field<T>, N> fields = {};
+	std::array<int8_t, SLOT_COUNT> slots = {};
+	uint32_t seed = 1;
+};
+
+// make a field table, e.g. constexpr auto fields = makeFields<Pad>({{"position", decodeMember<&Pad::position>}});
+template <typename T, size_t N>
+consteval FieldTable<T, N> makeFields(const Field<T> (&fields)[N]) {
+	return FieldTable<T, N>(fields);
+}
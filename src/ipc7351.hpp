@@ -0,0 +1,166 @@
+#pragma once
+
+#include <cmath>
+#include <vector>
+
+
+// IPC-7351 land pattern calculation
+
+// lead type, selects the solder fillet goals
+enum class LeadType {
+	// no calculation
+	NONE,
+
+	// rectangular end cap (resistors, capacitors)
+	CHIP,
+
+	// gull wing leads (SOIC, QFP)
+	GULLWING,
+
+	// gull wing leads with pitch of 0.625mm and less
+	GULLWING_FINE,
+
+	// j-leads (SOJ, PLCC)
+	J_LEAD,
+
+	// no leads (QFN, DFN)
+	NO_LEAD,
+};
+
+// density level
+enum class Density {
+	// most material
+	A,
+
+	// nominal material
+	B,
+
+	// least material
+	C,
+};
+
+// solder fillet goals and courtyard excess
+struct FilletGoals {
+	double toe;
+	double heel;
+	double side;
+	double courtyard;
+};
+
+// fillet goals indexed by lead type and density level
+constexpr FilletGoals filletGoals[][3] = {
+	// NONE
+	{{0, 0, 0, 0}, {0, 0, 0, 0}, {0, 0, 0, 0}},
+
+	// CHIP
+	{{0.55, 0, 0.05, 0.5}, {0.35, 0, 0, 0.25}, {0.15, 0, -0.05, 0.1}},
+
+	// GULLWING
+	{{0.55, 0.45, 0.05, 0.5}, {0.35, 0.35, 0.03, 0.25}, {0.15, 0.25, 0.01, 0.1}},
+
+	// GULLWING_FINE
+	{{0.55, 0.45, 0.01, 0.5}, {0.35, 0.35, -0.02, 0.25}, {0.15, 0.25, -0.04, 0.1}},
+
+	// J_LEAD
+	{{0.55, -0.1, 0.05, 0.5}, {0.35, -0.2, 0.03, 0.25}, {0.15, -0.3, 0.01, 0.1}},
+
+	// NO_LEAD
+	{{0.4, 0, -0.04, 0.5}, {0.3, 0, -0.04, 0.25}, {0.2, 0, -0.04, 0.1}},
+};
+
+inline const FilletGoals &getFilletGoals(LeadType lead, Density density) {
+	return filletGoals[int(lead)][int(density)];
+}
+
+// board fabrication and component placement tolerance
+constexpr double fabricationTolerance = 0.05;
+constexpr double placementTolerance = 0.025;
+
+// land patterns are rounded to this grid (Z up, G down, X up)
+constexpr double landGrid = 0.01;
+
+
+// batch of land pattern calculations as structure of arrays so that the compiler can vectorize the kernel
+struct LandPatternBatch {
+	// component dimensions: lead span (toe to toe), terminal length and terminal width
+	std::vector<double> spanMin;
+	std::vector<double> spanMax;
+	std::vector<double> terminalMin;
+	std::vector<double> terminalMax;
+	std::vector<double> widthMin;
+	std::vector<double> widthMax;
+
+	// fillet goals
+	std::vector<double> toe;
+	std::vector<double> heel;
+	std::vector<double> side;
+
+	// results: outer extent of the lands (Z), inner extent (G) and land width (X)
+	std::vector<double> z;
+	std::vector<double> g;
+	std::vector<double> x;
+
+	int size() const {return int(this->spanMin.size());}
+
+	// add a component, returns the index of the result
+	int add(double spanMin, double spanMax, double terminalMin, double terminalMax, double widthMin,
+		double widthMax, const FilletGoals &goals)
+	{
+		this->spanMin.push_back(spanMin);
+		this->spanMax.push_back(spanMax);
+		this->terminalMin.push_back(terminalMin);
+		this->terminalMax.push_back(terminalMax);
+		this->widthMin.push_back(widthMin);
+		this->widthMax.push_back(widthMax);
+		this->toe.push_back(goals.toe);
+		this->heel.push_back(goals.heel);
+		this->side.push_back(goals.side);
+		return size() - 1;
+	}
+
+	// run the kernel over all components
+	void calculate() {
+		int count = size();
+		this->z.resize(count);
+		this->g.resize(count);
+		this->x.resize(count);
+
+		const double *spanMin = this->spanMin.data();
+		const double *spanMax = this->spanMax.data();
+		const double *terminalMin = this->terminalMin.data();
+		const double *terminalMax = this->terminalMax.data();
+		const double *widthMin = this->widthMin.data();
+		const double *widthMax = this->widthMax.data();
+		const double *toe = this->toe.data();
+		const double *heel = this->heel.data();
+		const double *side = this->side.data();
+		double *z = this->z.data();
+		double *g = this->g.data();
+		double *x = this->x.data();
+
+		constexpr double fp2 = fabricationTolerance * fabricationTolerance + placementTolerance * placementTolerance;
+		constexpr double scale = 1.0 / landGrid;
+		for (int i = 0; i < count; ++i) {
+			// tolerances of span, inner span (between the terminals) and width
+			double cl = spanMax[i] - spanMin[i];
+			double innerMin = spanMin[i] - 2.0 * terminalMax[i];
+			double innerMax = spanMax[i] - 2.0 * terminalMin[i];
+			double cs = innerMax - innerMin;
+			double cw = widthMax[i] - widthMin[i];
+
+			// Zmax = Lmin + 2Jt + sqrt(CL^2 + F^2 + P^2)
+			double zMax = spanMin[i] + 2.0 * toe[i] + std::sqrt(cl * cl + fp2);
+
+			// Gmin = Smax - 2Jh - sqrt(CS^2 + F^2 + P^2)
+			double gMin = innerMax - 2.0 * heel[i] - std::sqrt(cs * cs + fp2);
+
+			// Xmax = Wmin + 2Js + sqrt(CW^2 + F^2 + P^2)
+			double xMax = widthMin[i] + 2.0 * side[i] + std::sqrt(cw * cw + fp2);
+
+			// round to grid, small epsilon so that exact grid values stay
+			z[i] = std::ceil(zMax * scale - 1e-6) * landGrid;
+			g[i] = std::floor(gMin * scale + 1e-6) * landGrid;
+			x[i] = std::ceil(xMax * scale - 1e-6) * landGrid;
+		}
+	}
+};
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+
+// pool of interned strings that stay valid for the lifetime of the pool
+class StringPool {
+public:
+	std::string_view add(std::string_view str) {
+		if (str.size() > CHUNK_SIZE) {
+			// dedicated chunk for long strings
+			this->chunks.emplace(this->chunks.begin(), new char[str.size()]);
+			std::memcpy(this->chunks.front().get(), str.data(), str.size());
+			return {this->chunks.front().get(), str.size()};
+		}
+		if (this->chunks.empty() || str.size() > CHUNK_SIZE - this->used) {
+			this->chunks.emplace_back(new char[CHUNK_SIZE]);
+			this->used = 0;
+		}
+		char *data = this->chunks.back().get() + this->used;
+		std::memcpy(data, str.data(), str.size());
+		this->used += str.size();
+		return {data, str.size()};
+	}
+
+private:
+	static constexpr size_t CHUNK_SIZE = 65536;
+
+	std::vector<std::unique_ptr<char[]>> chunks;
+	size_t used = 0;
+};
+
+
+// library of named values with interned names, contiguous storage of the values and an open addressing hash index
+template <typename T>
+class Library {
+public:
+	int size() const {return int(this->values.size());}
+	bool empty() const {return this->values.empty();}
+
+	std::string_view name(int index) const {return this->names[index];}
+	T &operator [](int index) {return this->values[index];}
+	const T &operator [](int index) const {return this->values[index];}
+
+	// get index of a value, -1 if not found
+	int find(std::string_view name) const {
+		if (this->slots.empty())
+			return -1;
+		return this->slots[lookup(name, hash(name))].index;
+	}
+
+	bool contains(std::string_view name) const {return find(name) != -1;}
+
+	// add a value, replaces an existing value with the same name
+	T &add(std::string_view name, T value) {
+		// keep load factor below 0.5
+		if ((this->values.size() + 1) * 2 > this->slots.size())
+			grow();
+
+		uint32_t h = hash(name);
+		auto &slot = this->slots[lookup(name, h)];
+		if (slot.index != -1)
+			return this->values[slot.index] = std::move(value);
+
+		slot = {h, int32_t(this->values.size())};
+		this->names.push_back(this->pool.add(name));
+		return this->values.emplace_back(std::move(value));
+	}
+
+private:
+	struct Slot {
+		uint32_t hash;
+		int32_t index;
+	};
+
+	static uint32_t hash(std::string_view name) {
+		return uint32_t(std::hash<std::string_view>()(name));
+	}
+
+	// find slot of name or the empty slot where it would be inserted (linear probing)
+	size_t lookup(std::string_view name, uint32_t h) const {
+		size_t mask = this->slots.size() - 1;
+		size_t i = h & mask;
+		while (true) {
+			auto &slot = this->slots[i];
+			if (slot.index == -1 || (slot.hash == h && this->names[slot.index] == name))
+				return i;
+			i = (i + 1) & mask;
+		}
+	}
+
+	void grow() {
+		this->slots.assign(std::max(this->slots.size() * 2, size_t(16)), {0, -1});
+		size_t mask = this->slots.size() - 1;
+		for (int index = 0; index < int(this->names.size()); ++index) {
+			uint32_t h = hash(this->names[index]);
+			size_t i = h & mask;
+			while (this->slots[i].index != -1)
+				i = (i + 1) & mask;
+			this->slots[i] = {h, index};
+		}
+	}
+
+	StringPool pool;
+	std::vector<std::string_view> names;
+	std::vector<T> values;
+	std::vector<Slot> slots;
+};
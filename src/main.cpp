@@ -1,10 +1,37 @@
 #include "clipper2.hpp"
+#include "affine.hpp"
+#include "allocstats.hpp"
+#include "decompress.hpp"
 #include "double3.hpp"
+#include "emitter.hpp"
+#include "fields.hpp"
+#include "ipc7351.hpp"
+#include "library.hpp"
+#include "mapped.hpp"
+#include "parallel.hpp"
+#include "presets.hpp"
+#include "queue.hpp"
+#include "sexpr.hpp"
+#include "spatial.hpp"
+#include "writer.hpp"
 #include <nlohmann/json.hpp>
 #include <iostream>
 #include <fstream>
 #include <filesystem>
 #include <set>
+#include <map>
+#include <list>
+#include <unordered_map>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <mutex>
+#include <shared_mutex>
+#include <functional>
+#include <cmath>
+#include <limits>
+#include <numbers>
+#include <thread>
 
 
 using json = nlohmann::json;
@@ -12,12 +39,8 @@ namespace fs = std::filesystem;
 
 
 
-// shapes
-constexpr double CIRCLE = 0.5; // oval if width not equal to height
-constexpr double ROUNDRECT = 0.25; // 25% (KiCad default)
-constexpr double ROUNDRECT10 = 0.1; // 10%
-constexpr double ROUNDRECT5 = 0.05; // 5%
-constexpr double RECT = 0;
+// output formats
+using Output = Emitters<KicadEmitter, Kicad8Emitter, GeometryEmitter, SvgEmitter>;
 
 
 struct Footprint {
@@ -113,6 +136,9 @@ struct Footprint {
         // mirror pads (pin 1 right instead of left)
         bool mirror = false;
 
+        // rotation of the pad array around its position in degrees (counter-clockwise)
+        double rotation = 0;
+
         // numbering scheme
         Numbering numbering = Numbering::CIRCULAR;
 
@@ -128,6 +154,21 @@ struct Footprint {
         // pad names (override numbers)
         std::vector<std::string> names;
 
+        // IPC-7351 component dimensions (min, max), used to calculate size and distance (pitch for single)
+        struct Ipc {
+            LeadType lead = LeadType::NONE;
+            Density density = Density::B;
+
+            // lead span (toe to toe)
+            double2 span;
+
+            // terminal length
+            double2 terminal;
+
+            // terminal width
+            double2 width;
+        } ipc;
+
         // check if pin exists (pin with empty name does not exist)
         bool exists(int index) const {
             return index >= this->names.size() || !this->names[index].empty();
@@ -157,6 +198,16 @@ struct Footprint {
         double radius;
     };
 
+    // arc, angles in degrees
+    struct Arc {
+        std::string layer;
+        double width;
+        double2 center;
+        double radius;
+        double startAngle;
+        double angle;
+    };
+
 
     // true if this is a template, i.e. no footprint gets generated
     bool template_ = false;
@@ -188,12 +239,24 @@ struct Footprint {
     // courtyard size is body size plus courtyardAdd
     double2 courtyardAdd;
 
+    // margin around pads that reach past the courtyard rectangle
+    double courtyardMargin = 0.25;
+
     // global position
     double2 position;
 
     // offset of body
     double3 offset;
 
+    // rotation of the footprint around its origin in degrees (counter-clockwise)
+    double rotation = 0;
+
+    // also generate a mirrored variant for the back side of the board (name_Back)
+    bool backVariant = false;
+
+    // named parameters for expressions in numeric fields
+    Parameters parameters;
+
     // list of pads (pad arrays)
     std::vector<Pad> pads;
 
@@ -201,6 +264,7 @@ struct Footprint {
     // shapes
     std::vector<Line> lines;
     std::vector<Circle> circles;
+    std::vector<Arc> arcs;
 
 
     // get type of footrpint
@@ -217,272 +281,751 @@ struct Footprint {
     }
 };
 
-void read(json &j, const std::string &key, std::string &value) {
-    value = j.value(key, value);
+// decode array of objects into a vector, existing (inherited) elements are decoded into so that a variant only needs
+// to give the fields that differ from its parent
+template <typename T, typename F>
+void decodeArray(const json &value, std::vector<T> &vector, const F &fields) {
+    int count = value.size();
+    vector.resize(count);
+    for (int i = 0; i < count; ++i) {
+        fields.decode(value.at(i), vector[i]);
+    }
 }
 
-void read(json &j, const std::string &key, bool &value) {
-    value = j.value(key, value);
-}
+// IPC-7351 component dimensions
+constexpr auto ipcFields = makeFields<Footprint::Pad::Ipc>({
+    // lead type
+    {"lead", [](const json &value, Footprint::Pad::Ipc &ipc) {
+        auto lead = value.get<std::string>();
+        if (lead == "chip")
+            ipc.lead = LeadType::CHIP;
+        else if (lead == "gullwing")
+            ipc.lead = LeadType::GULLWING;
+        else if (lead == "j-lead")
+            ipc.lead = LeadType::J_LEAD;
+        else if (lead == "no-lead")
+            ipc.lead = LeadType::NO_LEAD;
+        else
+            throw std::runtime_error("unknown lead type '" + lead + "'");
+    }},
+
+    // density level
+    {"density", [](const json &value, Footprint::Pad::Ipc &ipc) {
+        auto density = value.get<std::string>();
+        if (density == "A")
+            ipc.density = Density::A;
+        else if (density == "B")
+            ipc.density = Density::B;
+        else if (density == "C")
+            ipc.density = Density::C;
+        else
+            throw std::runtime_error("unknown density level '" + density + "'");
+    }},
 
-void read(json &j, const std::string &key, int &value) {
-    value = j.value(key, value);
-}
+    // lead span, terminal length and width (min, max)
+    {"span", decodeMember<&Footprint::Pad::Ipc::span>},
+    {"terminal", decodeMember<&Footprint::Pad::Ipc::terminal>},
+    {"width", decodeMember<&Footprint::Pad::Ipc::width>},
+});
 
-void read(json &j, const std::string &key, double &value) {
-    value = j.value(key, value);
-}
+constexpr auto padFields = makeFields<Footprint::Pad>({
+    // type
+    {"type", [](const json &value, Footprint::Pad &pad) {
+        auto type = value.get<std::string>();
+        if (type == "single")
+            pad.type = Footprint::Pad::Type::SINGLE;
+        else if (type == "dual")
+            pad.type = Footprint::Pad::Type::DUAL;
+        else if (type == "quad")
+            pad.type = Footprint::Pad::Type::QUAD;
+        else if (type == "grid")
+            pad.type = Footprint::Pad::Type::GRID;
+        else
+            throw std::runtime_error("unknown pad type '" + type + "'");
+    }},
 
-void readRelaxed(json &j, const std::string &key, double2 &value) {
-    if (j.contains(key)) {
-        json jv = j.at(key);
-        if (jv.is_number()) {
-            value.x = jv.get<double>();
-            value.y = value.x;
-        } else if (jv.is_array()) {
-            value.x = jv.at(0).get<double>();
-            if (jv.size() >= 2)
-                value.y = jv.at(1).get<double>();
-            else
-                value.y = value.x;
-        }
-    }
-}
+    // position, size and offset
+    {"position", decodeMember<&Footprint::Pad::position>},
+    {"size", decodeRelaxedMember<&Footprint::Pad::size>},
+    {"offset", decodeRelaxedMember<&Footprint::Pad::offset>},
 
-void read(json &j, const std::string &key, double2 &value) {
-    if (j.contains(key)) {
-        json jv = j.at(key);
-        value.x = jv.at(0).get<double>();
-        value.y = jv.at(1).get<double>();
-    }
-}
+    // shape
+    {"shape", decodeMember<&Footprint::Pad::shape>},
 
-void read(json &j, const std::string &key, double3 &value) {
-    if (j.contains(key)) {
-        json jv = j.at(key);
-        value.x = jv.at(0).get<double>();
-        value.y = jv.at(1).get<double>();
-        value.z = jv.at(2).get<double>();
-    }
-}
+    // drill size and offset
+    {"drillSize", decodeRelaxedMember<&Footprint::Pad::drillSize>},
+    {"drillOffset", decodeRelaxedMember<&Footprint::Pad::drillOffset>},
 
+    // clearance and solder mask margin
+    {"clearance", decodeMember<&Footprint::Pad::clearance>},
+    {"maskMargin", decodeMember<&Footprint::Pad::maskMargin>},
 
-void readPad(json &j, Footprint::Pad &pad) {
-    // type
-    std::string type = j.value("type", std::string());
-    if (type == "dual")
-        pad.type = Footprint::Pad::Type::DUAL;
-    else if (type == "quad")
-        pad.type = Footprint::Pad::Type::QUAD;
-    else if (type == "grid")
-        pad.type = Footprint::Pad::Type::GRID;
+    // back side
+    {"back", decodeMember<&Footprint::Pad::back>},
 
-    // position
-    read(j, "position", pad.position);
+    // pitch, distance and pad count
+    {"pitch", decodeMember<&Footprint::Pad::pitch>},
+    {"distance", decodeRelaxedMember<&Footprint::Pad::distance>},
+    {"count", decodeMember<&Footprint::Pad::count>},
 
-    // size
-    readRelaxed(j, "size", pad.size);
+    // mirror
+    {"mirror", decodeMember<&Footprint::Pad::mirror>},
 
-    // offset
-    readRelaxed(j, "offset", pad.offset);
+    // rotation of the array
+    {"rotation", decodeMember<&Footprint::Pad::rotation>},
 
-    // shape
-    read(j, "shape", pad.shape);
+    // numbering
+    {"numbering", [](const json &value, Footprint::Pad &pad) {
+        auto numbering = value.get<std::string>();
+        if (numbering == "circular")
+            pad.numbering = Footprint::Pad::Numbering::CIRCULAR;
+        else if (numbering == "columns")
+            pad.numbering = Footprint::Pad::Numbering::COLUMNS;
+        else if (numbering == "rows")
+            pad.numbering = Footprint::Pad::Numbering::ROWS;
+        else
+            throw std::runtime_error("unknown numbering '" + numbering + "'");
+    }},
 
-    // drill size
-    readRelaxed(j, "drillSize", pad.drillSize);
+    // double, first pad number and pad number increment
+    {"double", decodeMember<&Footprint::Pad::double_>},
+    {"number", decodeMember<&Footprint::Pad::number>},
+    {"increment", decodeMember<&Footprint::Pad::increment>},
 
-    // drill offset
-    readRelaxed(j, "drillOffset", pad.drillOffset);
+    // pad names
+    {"names", [](const json &value, Footprint::Pad &pad) {
+        for (auto &name : value) {
+            pad.names.push_back(name.get<std::string>());
+        }
+    }},
 
-    // clearance
-    read(j, "clearance", pad.clearance);
+    // IPC-7351 component dimensions
+    {"ipc", [](const json &value, Footprint::Pad &pad) {
+        ipcFields.decode(value, pad.ipc);
+    }},
+});
 
-    // solder mask margin
-    read(j, "maskMargin", pad.maskMargin);
+constexpr auto lineFields = makeFields<Footprint::Line>({
+    {"layer", decodeMember<&Footprint::Line::layer>},
+    {"width", decodeMember<&Footprint::Line::width>},
 
-    // back side
-    read(j, "back", pad.back);
+    // points as flat list of coordinates
+    {"points", [](const json &value, Footprint::Line &line) {
+        int size = value.size();
+        for (int i = 0; i < size - 1; i += 2) {
+            double x = value.at(i + 0).get<double>();
+            double y = value.at(i + 1).get<double>();
+            line.points.emplace_back(x, y);
+        }
+    }},
+});
+
+constexpr auto circleFields = makeFields<Footprint::Circle>({
+    {"layer", decodeMember<&Footprint::Circle::layer>},
+    {"width", decodeMember<&Footprint::Circle::width>},
+    {"center", decodeMember<&Footprint::Circle::center>},
+    {"diameter", [](const json &value, Footprint::Circle &circle) {
+        circle.radius = value.get<double>() * 0.5;
+    }},
+});
+
+// arc, angles in degrees
+constexpr auto arcFields = makeFields<Footprint::Arc>({
+    {"layer", decodeMember<&Footprint::Arc::layer>},
+    {"width", decodeMember<&Footprint::Arc::width>},
+    {"center", decodeMember<&Footprint::Arc::center>},
+    {"diameter", [](const json &value, Footprint::Arc &arc) {
+        arc.radius = value.get<double>() * 0.5;
+    }},
+    {"startAngle", decodeMember<&Footprint::Arc::startAngle>},
+    {"angle", decodeMember<&Footprint::Arc::angle>},
+});
+
+constexpr auto footprintFields = makeFields<Footprint>({
+    // template
+    {"template", decodeMember<&Footprint::template_>},
 
-    // pitch
-    read(j, "pitch", pad.pitch);
+    // description
+    {"description", decodeMember<&Footprint::description>},
 
-    // distance
-    readRelaxed(j, "distance", pad.distance);
+    // body
+    {"body", decodeMember<&Footprint::body>},
 
-    // pad count
-    read(j, "count", pad.count);
+    // orientation (position of pin 1 marker)
+    {"orientation", [](const json &value, Footprint &footprint) {
+        auto orientation = value.get<std::string>();
+        if (orientation == "bottom-left")
+            footprint.orientation = Footprint::Orientation::BOTTOM_LEFT;
+        else if (orientation == "top-left")
+            footprint.orientation = Footprint::Orientation::TOP_LEFT;
+        else if (orientation == "bottom-right")
+            footprint.orientation = Footprint::Orientation::BOTTOM_RIGHT;
+        else
+            throw std::runtime_error("unknown orientation '" + orientation + "'");
+    }},
 
-    // mirror
-    read(j, "mirror", pad.mirror);
+    // silkscreen
+    {"silkscreen", decodeMember<&Footprint::silkscreen>},
+    {"silkscreenAdd", decodeRelaxedMember<&Footprint::silkscreenAdd>},
 
-    // numbering
-    std::string numbering = j.value("numbering", std::string());
-    if (numbering == "columns")
-        pad.numbering = Footprint::Pad::Numbering::COLUMNS;
-    else if (numbering == "rows")
-        pad.numbering = Footprint::Pad::Numbering::ROWS;
+    // courtyard
+    {"courtyard", decodeMember<&Footprint::courtyard>},
+    {"courtyardAdd", decodeRelaxedMember<&Footprint::courtyardAdd>},
+    {"courtyardMargin", decodeMember<&Footprint::courtyardMargin>},
 
-    // double
-    read(j, "double", pad.double_);
+    // global position
+    {"position", decodeMember<&Footprint::position>},
 
-    // first pad number
-    read(j, "number", pad.number);
+    // offset, applies only to body
+    {"offset", decodeMember<&Footprint::offset>},
 
-    // pad number increment
-    read(j, "increment", pad.increment);
+    // rotation of the whole footprint
+    {"rotation", decodeMember<&Footprint::rotation>},
 
-    // pad names
-    if (j.contains("names")) {
-        for (auto name : j.at("names")) {
-            pad.names.push_back(name.get<std::string>());
+    // mirrored back side variant
+    {"backVariant", decodeMember<&Footprint::backVariant>},
+
+    // pads or pad arrays
+    {"pads", [](const json &value, Footprint &footprint) {
+        decodeArray(value, footprint.pads, padFields);
+    }},
+
+    // lines or polylines, circles and arcs
+    {"lines", [](const json &value, Footprint &footprint) {
+        decodeArray(value, footprint.lines, lineFields);
+    }},
+    {"circles", [](const json &value, Footprint &footprint) {
+        decodeArray(value, footprint.circles, circleFields);
+    }},
+    {"arcs", [](const json &value, Footprint &footprint) {
+        decodeArray(value, footprint.arcs, arcFields);
+    }},
+
+    // type
+    {"type", [](const json &value, Footprint &footprint) {
+        auto type = value.get<std::string>();
+        if (type == "detect")
+            footprint.type = Footprint::Type::DETECT;
+        else if (type == "through hole")
+            footprint.type = Footprint::Type::THROUGH_HOLE;
+        else if (type == "smd")
+            footprint.type = Footprint::Type::SMD;
+        else
+            throw std::runtime_error("unknown footprint type '" + type + "'");
+    }},
+});
+
+// decode the fields of a footprint object, expressions use the parameters of the current scope
+void decodeFootprint(const json &j, Footprint &footprint) {
+    uint64_t decoded = footprintFields.decode(j, footprint);
+
+    // no pads
+    if (!(decoded & footprintFields.bit("pads")))
+        footprint.pads.clear();
+}
+
+// make a template footprint from a built-in preset
+Footprint makePreset(const Preset &preset) {
+    Footprint footprint;
+    footprint.template_ = true;
+    footprint.description = preset.description;
+    footprint.body = {preset.body[0], preset.body[1], preset.body[2]};
+
+    Footprint::Pad pad;
+    if (preset.pads == PresetPads::SINGLE) {
+        pad.type = Footprint::Pad::Type::SINGLE;
+    } else if (preset.pads == PresetPads::QUAD) {
+        pad.type = Footprint::Pad::Type::QUAD;
+    } else {
+        pad.type = Footprint::Pad::Type::DUAL;
+        if (preset.pads == PresetPads::DUAL_ZIGZAG)
+            pad.numbering = Footprint::Pad::Numbering::COLUMNS;
+    }
+    pad.count = preset.count;
+    pad.pitch = preset.pitch;
+    if (preset.lead != LeadType::NONE) {
+        pad.ipc.lead = preset.lead;
+        pad.ipc.span = {preset.span[0], preset.span[1]};
+        pad.ipc.terminal = {preset.terminal[0], preset.terminal[1]};
+        pad.ipc.width = {preset.width[0], preset.width[1]};
+    } else {
+        pad.size = {preset.size, preset.size};
+        pad.drillSize = {preset.drill, preset.drill};
+        pad.distance = {preset.distance, preset.distance};
+        pad.shape = preset.shape;
+    }
+
+    // pin names
+    if (!preset.names.empty()) {
+        std::string_view names = preset.names;
+        while (true) {
+            size_t comma = names.find(',');
+            pad.names.emplace_back(names.substr(0, comma));
+            if (comma == std::string_view::npos)
+                break;
+            names.remove_prefix(comma + 1);
         }
     }
+
+    footprint.pads.push_back(std::move(pad));
+    return footprint;
 }
 
-void readLine(json &j, Footprint::Line &line) {
-    // layer
-    read(j, "layer", line.layer);
+// read the parameters of a footprint and its ancestors (root first). Values are numbers or expressions. A variant can
+// override a parameter and the inherited expressions that use it see the new value, a parameter that uses itself
+// refers to the inherited definition
+void readParameters(const std::vector<const json *> &objects, Parameters &parameters) {
+    // definitions of each parameter, inherited first
+    std::map<std::string, std::vector<const json *>> definitions;
+    int count = 0;
+    for (auto object : objects) {
+        auto it = object->find("parameters");
+        if (it == object->end())
+            continue;
+        for (auto p = it->begin(); p != it->end(); ++p) {
+            definitions[p.key()].push_back(&p.value());
+            ++count;
+        }
+    }
 
-    // width
-    read(j, "width", line.width);
+    // evaluate a definition, a dependency chain longer than the number of definitions is a cycle
+    std::map<const json *, double> values;
+    std::function<double (const std::string &, int, int)> evaluate =
+        [&](const std::string &name, int level, int depth) -> double
+    {
+        if (depth > count)
+            throw std::runtime_error("parameter cycle via " + name);
+        auto value = definitions.at(name)[level];
+        auto it = values.find(value);
+        if (it != values.end())
+            return it->second;
+        if (!value->is_string())
+            return values[value] = value->get<double>();
+
+        // evaluate the used parameters first
+        auto &expression = getExpression(value->get_ref<const std::string &>());
+        Parameters used;
+        for (auto &n : expression.names()) {
+            if (n == name) {
+                if (level > 0)
+                    used.set(n, evaluate(n, level - 1, depth + 1));
+            } else {
+                auto d = definitions.find(n);
+                if (d != definitions.end())
+                    used.set(n, evaluate(n, int(d->second.size()) - 1, depth + 1));
+            }
+        }
+        return values[value] = expression.evaluate(used);
+    };
+    for (auto &[name, d] : definitions) {
+        parameters.set(name, evaluate(name, int(d.size()) - 1, 0));
+    }
+}
 
-    // pads or pad arrays
-    if (j.contains("points")) {
-        auto jp = j.at("points");
+// read a footprint. If it sets parameters, the ancestors (root first) get decoded again so that their expressions use
+// the new parameter values
+void readFootprint(const json &j, const Footprint *parent, std::vector<const json *> ancestors,
+    Footprint &footprint)
+{
+    if (!j.contains("parameters")) {
+        // inherit parent footprint
+        if (parent != nullptr) {
+            footprint = *parent;
+            footprint.template_ = false;
+        }
+    } else {
+        ancestors.push_back(&j);
+        readParameters(ancestors, footprint.parameters);
+        ancestors.pop_back();
 
-        int size = jp.size();
-        for (int i = 0; i < size - 1; i += 2) {
-            double x = jp.at(i + 0).get<double>();
-            double y = jp.at(i + 1).get<double>();
-            line.points.emplace_back(x, y);
+        ParameterScope scope(footprint.parameters);
+        for (auto ancestor : ancestors) {
+            decodeFootprint(*ancestor, footprint);
         }
+        footprint.template_ = false;
     }
+
+    ParameterScope scope(footprint.parameters);
+    decodeFootprint(j, footprint);
 }
 
-void readCircle(json &j, Footprint::Circle &circle) {
-    // layer
-    read(j, "layer", circle.layer);
+// resource limits, footprints that exceed them fail fast instead of stalling the build
+struct Limits {
+    // pads of a footprint
+    int pads = 10000;
 
-    // width
-    read(j, "width", circle.width);
+    // points of the lines of a footprint, circles and arcs count as one point
+    int points = 100000;
 
-    // center
-    read(j, "center", circle.center);
+    // length of an inheritance chain
+    int depth = 100;
+};
 
-    // diameter
-    double diameter;
-    read(j, "diameter", diameter);
-    circle.radius = diameter * 0.5;
+// number of pads of a footprint
+int64_t countPads(const Footprint &footprint) {
+    int64_t pads = 0;
+    for (auto &pad : footprint.pads)
+        pads += std::max(pad.count, 0);
+    return pads;
 }
 
+// number of points of the lines of a footprint, circles and arcs count as one point
+int64_t countPoints(const Footprint &footprint) {
+    int64_t points = footprint.circles.size() + footprint.arcs.size();
+    for (auto &line : footprint.lines)
+        points += line.points.size();
+    return points;
+}
 
-void readFootprint(json &j, std::map<std::string, Footprint> &footprints, Footprint &footprint) {
-    // inherit existing footprint
-    std::string inherit = j.value("inherit", std::string());
-    if (footprints.contains(inherit)) {
-        footprint = footprints[inherit];
-        footprint.template_ = false;
+// check a footprint against the limits, throws std::runtime_error if a limit is exceeded
+void checkLimits(const Footprint &footprint, const Limits &limits) {
+    int64_t pads = countPads(footprint);
+    if (pads > limits.pads) {
+        throw std::runtime_error(std::to_string(pads) + " pads exceed the limit of " + std::to_string(limits.pads)
+            + " (--max-pads)");
     }
 
-    // template
-    read(j, "template", footprint.template_);
+    int64_t points = countPoints(footprint);
+    if (points > limits.points) {
+        throw std::runtime_error(std::to_string(points) + " points exceed the limit of "
+            + std::to_string(limits.points) + " (--max-points)");
+    }
+}
 
-    // description
-    read(j, "description", footprint.description);
+// a single row land pattern is a two terminal component, e.g. chip resistor
+bool isTwoTerminal(const Footprint::Pad &pad) {
+    return pad.type == Footprint::Pad::Type::SINGLE && pad.count == 2;
+}
 
-    // body
-    read(j, "body", footprint.body);
+// check that the land pattern calculation supports the pad arrays, throws std::runtime_error if not
+void checkLandPatterns(const Footprint &footprint) {
+    for (auto &pad : footprint.pads) {
+        if (pad.ipc.lead != LeadType::NONE && pad.type == Footprint::Pad::Type::SINGLE && !isTwoTerminal(pad)) {
+            throw std::runtime_error("IPC-7351 land pattern of a single row needs 2 pads, not "
+                + std::to_string(pad.count));
+        }
+    }
+}
 
-    // orientation (position of pin 1 marker)
-    std::string orientation = j.value("orientation", std::string());
-    if (orientation == "top-left")
-        footprint.orientation = Footprint::Orientation::TOP_LEFT;
-    else if (orientation == "bottom-right")
-        footprint.orientation = Footprint::Orientation::BOTTOM_RIGHT;
+// footprint with resolved inheritance and land patterns, ready for generation
+struct ResolvedFootprint {
+    std::string name;
+    Footprint footprint;
+};
 
-    // silkscreen
-    read(j, "silkscreen", footprint.silkscreen);
-    readRelaxed(j, "silkscreenAdd", footprint.silkscreenAdd);
+// receives the footprints of one inheritance level as soon as the level is resolved
+using ResolvedCallback = std::function<void (std::vector<ResolvedFootprint> &level)>;
 
-    // courtyard
-    read(j, "courtyard", footprint.courtyard);
-    readRelaxed(j, "courtyardAdd", footprint.courtyardAdd);
+// calculate pad size, distance and courtyard from the IPC-7351 component dimensions. The pads of all footprints of an
+// inheritance level go through one batch before layout
+void calculateLandPatterns(std::vector<ResolvedFootprint> &footprints) {
+    struct Target {
+        Footprint *footprint;
+        Footprint::Pad *pad;
+    };
 
-    // global position
-    read(j, "position", footprint.position);
+    // collect
+    LandPatternBatch batch;
+    std::vector<Target> targets;
+    for (auto &resolved : footprints) {
+        auto &footprint = resolved.footprint;
+        for (auto &pad : footprint.pads) {
+            auto &ipc = pad.ipc;
+            if (ipc.lead == LeadType::NONE || (pad.type == Footprint::Pad::Type::SINGLE && !isTwoTerminal(pad)))
+                continue;
+
+            // gull wing leads with fine pitch get less side fillet
+            auto lead = ipc.lead == LeadType::GULLWING && pad.pitch <= 0.625 ? LeadType::GULLWING_FINE : ipc.lead;
+            batch.add(ipc.span.x, ipc.span.y, ipc.terminal.x, ipc.terminal.y, ipc.width.x, ipc.width.y,
+                getFilletGoals(lead, ipc.density));
+            targets.push_back({&footprint, &pad});
+        }
+    }
+    if (targets.empty())
+        return;
+
+    // calculate
+    batch.calculate();
+
+    // apply
+    for (int i = 0; i < int(targets.size()); ++i) {
+        auto &footprint = *targets[i].footprint;
+        auto &pad = *targets[i].pad;
+
+        double length = (batch.z[i] - batch.g[i]) * 0.5;
+        double width = batch.x[i];
+        double distance = (batch.z[i] + batch.g[i]) * 0.5;
+
+        // pads extend along y if the pad rows are horizontal
+        bool horizontal = footprint.orientation == Footprint::Orientation::BOTTOM_LEFT;
+        if (pad.type == Footprint::Pad::Type::SINGLE) {
+            // two terminal component
+            pad.pitch = distance;
+            horizontal = !horizontal;
+        } else if (pad.type == Footprint::Pad::Type::QUAD) {
+            pad.distance = {distance, distance};
+            horizontal = true;
+        } else {
+            pad.distance.x = distance;
+        }
+        pad.size = horizontal ? double2(width, length) : double2(length, width);
+    }
 
-    // offset, applies only to body
-    read(j, "offset", footprint.offset);
+    // courtyard excess around body and pads, the largest of all pad arrays of a footprint (targets of a footprint are
+    // consecutive)
+    for (size_t i = 0; i < targets.size();) {
+        auto footprint = targets[i].footprint;
+        double excess = 0;
+        for (; i < targets.size() && targets[i].footprint == footprint; ++i) {
+            auto &ipc = targets[i].pad->ipc;
+            excess = std::max(excess, getFilletGoals(ipc.lead, ipc.density).courtyard);
+        }
+        footprint->courtyardAdd = {excess * 2.0, excess * 2.0};
+        footprint->courtyardMargin = excess;
+    }
+}
 
-    // pads or pad arrays
-    if (j.contains("pads")) {
-        auto jp = j.at("pads");
+// resolve inheritance: build dependency graph from the inherit references and read the footprints in topological
+// order so that the key order in the file does not matter. Footprints whose parents are done get read in parallel and
+// are passed on level by level so that generation can start before all levels are read
+void readFootprints(json &j, const ResolvedCallback &resolved, const Limits &limits) {
+    struct Entry {
+        json *value = nullptr; // nullptr for a built-in preset
+        int parent = -1;
+        std::vector<int> children = {};
+        Footprint footprint = {};
+        std::string error = {};
+    };
+
+    // collect entries, the footprints get resolved in place in the contiguous storage of the library
+    Library<Entry> entries;
+    for (auto& [name, value] : j.items())
+        entries.add(name, {&value});
 
-        int size = jp.size();
-        footprint.pads.resize(size);
-        for (int i = 0; i < size; ++i) {
-            // read pad or pad array
-            readPad(jp.at(i), footprint.pads[i]);
+    // build dependency graph, built-in presets that get inherited are added as entries that are already read
+    std::vector<int> level;
+    int count = entries.size();
+    for (int i = 0; i < count; ++i) {
+        std::string inherit = entries[i].value->value("inherit", std::string());
+        int parent = inherit.empty() ? -1 : entries.find(inherit);
+        if (parent == -1 && !inherit.empty()) {
+            auto preset = findPreset(inherit);
+            if (preset != nullptr) {
+                entries.add(inherit, {nullptr, -1, {}, makePreset(*preset)});
+                parent = entries.size() - 1;
+                level.push_back(parent);
+            }
         }
-    } else {
-        // no pads
-        footprint.pads.clear();
+
+        auto &entry = entries[i];
+        if (inherit.empty()) {
+            level.push_back(i);
+        } else {
+            if (parent == -1) {
+                // gets skipped, but its children are reported as failed
+                entry.error = "missing parent " + inherit;
+                level.push_back(i);
+            } else {
+                entry.parent = parent;
+                entries[entry.parent].children.push_back(i);
+            }
+        }
+    }
+
+    // read level by level, starting with the footprints that have no parent
+    std::vector<bool> done(entries.size());
+    for (int depth = 1; !level.empty(); ++depth) {
+        parallelFor(level.size(), [&](int i) {
+            auto &entry = entries[level[i]];
+            if (!entry.error.empty() || entry.value == nullptr)
+                return;
+            if (depth > limits.depth) {
+                entry.error = "inheritance chain exceeds the limit of " + std::to_string(limits.depth)
+                    + " (--max-depth)";
+                return;
+            }
+            const Footprint *parent = entry.parent == -1 ? nullptr : &entries[entry.parent].footprint;
+            ALLOC_SCOPE(Stage::INHERIT, "readFootprint");
+            try {
+                // ancestors get decoded again if the footprint sets parameters
+                std::vector<const json *> ancestors;
+                if (entry.value->contains("parameters")) {
+                    for (int p = entry.parent; p != -1; p = entries[p].parent) {
+                        // a preset is the base the ancestors get decoded into
+                        if (entries[p].value == nullptr)
+                            entry.footprint = entries[p].footprint;
+                        else
+                            ancestors.insert(ancestors.begin(), entries[p].value);
+                    }
+                }
+                readFootprint(*entry.value, parent, std::move(ancestors), entry.footprint);
+                checkLimits(entry.footprint, limits);
+                if (!entry.footprint.template_)
+                    checkLandPatterns(entry.footprint);
+            } catch (std::exception &e) {
+                // parsing the footprint failed
+                entry.error = e.what();
+            }
+        });
+
+        std::vector<int> next;
+        std::vector<ResolvedFootprint> footprints;
+        for (int index : level) {
+            auto &entry = entries[index];
+            std::string name(entries.name(index));
+            done[index] = true;
+            for (int child : entry.children) {
+                if (!entry.error.empty())
+                    entries[child].error = "parent " + name + " failed";
+                next.push_back(child);
+            }
+            if (!entry.error.empty()) {
+                std::cerr << name << ": " << entry.error << std::endl;
+                continue;
+            }
+            if (entry.value == nullptr)
+                continue;
+
+            // land patterns get calculated on the copy so that children inherit the unmodified footprint
+            if (entry.children.empty())
+                footprints.push_back({std::move(name), std::move(entry.footprint)});
+            else
+                footprints.push_back({std::move(name), entry.footprint});
+        }
+        level = std::move(next);
+
+        calculateLandPatterns(footprints);
+        resolved(footprints);
     }
 
-    // lines or polylines
-    if (j.contains("lines")) {
-        auto jl = j.at("lines");
+    // report errors, entries that were not reached are part of a cycle
+    for (int i = 0; i < entries.size(); ++i) {
+        auto &entry = entries[i];
+        if (!done[i] && entry.error.empty()) {
+            // check if the entry is part of the cycle or only inherits from it
+            int p = entry.parent;
+            for (int k = 0; k < entries.size() && p != i; ++k)
+                p = entries[p].parent;
+            if (p == i)
+                entry.error = "inheritance cycle via " + std::string(entries.name(entry.parent));
+            else
+                entry.error = "parent " + std::string(entries.name(entry.parent)) + " is part of an inheritance cycle";
+        }
+        if (!done[i])
+            std::cerr << entries.name(i) << ": " << entry.error << std::endl;
+    }
+}
 
-        int count = jl.size();
-        footprint.lines.resize(count);
-        for (int i = 0; i < count; ++i) {
-            // read line or polyline
-            readLine(jl.at(i), footprint.lines[i]);
+// match name against a glob pattern with * and ?
+bool matchGlob(std::string_view pattern, std::string_view name) {
+    size_t p = 0;
+    size_t n = 0;
+    size_t star = std::string_view::npos;
+    size_t mark = 0;
+    while (n < name.size()) {
+        if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == name[n])) {
+            ++p;
+            ++n;
+        } else if (p < pattern.size() && pattern[p] == '*') {
+            star = p++;
+            mark = n;
+        } else if (star != std::string_view::npos) {
+            p = star + 1;
+            n = ++mark;
+        } else {
+            return false;
         }
     }
+    while (p < pattern.size() && pattern[p] == '*')
+        ++p;
+    return p == pattern.size();
+}
 
-    // circles
-    if (j.contains("circles")) {
-        auto jc = j.at("circles");
+// selection of footprints to generate given by glob patterns, selects all if empty
+struct Selection {
+    std::vector<std::string> patterns;
+
+    bool all() const {return this->patterns.empty();}
 
-        int count = jc.size();
-        footprint.circles.resize(count);
-        for (int i = 0; i < count; ++i) {
-            // read circle
-            readCircle(jc.at(i), footprint.circles[i]);
+    bool matches(std::string_view name) const {
+        if (all())
+            return true;
+        for (auto &pattern : this->patterns) {
+            if (matchGlob(pattern, name))
+                return true;
         }
+        return false;
     }
 
-    // type
-    std::string type = j.value("type", std::string());
-    if (type == "through hole")
-        footprint.type = Footprint::Type::THROUGH_HOLE;
-    else if (type == "smd")
-        footprint.type = Footprint::Type::SMD;
+    // read patterns from file, one per line, empty lines and lines starting with # are ignored
+    bool read(const fs::path &path) {
+        std::ifstream s(path.string());
+        if (!s.is_open())
+            return false;
+        std::string line;
+        while (std::getline(s, line)) {
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+            if (!line.empty() && line[0] != '#')
+                this->patterns.push_back(line);
+        }
+        return true;
+    }
+};
+
+json parseJson(const std::string &data, const json::parser_callback_t &callback = nullptr) {
+    return json::parse(data,
+        callback,
+        true, // allow exceptions
+        true); // ignore comments
 }
 
-void readJson(const fs::path &path, std::map<std::string, Footprint> &footprints) {
-    // read config
-    std::ifstream s(path.string());
-    if (s.is_open()) {
-        try {
-            json j = json::parse(s,
-                nullptr, // callback
-                true, // allow exceptions
-                true); // ignore comments
+// parse only the selected footprints and their ancestors, all other entries are skipped while parsing
+json parseSelected(const std::string &data, const Selection &selection) {
+    // first pass: only keep inherit of each entry
+    json index = parseJson(data, [](int depth, json::parse_event_t event, json &parsed) {
+        return depth != 2 || event != json::parse_event_t::key || parsed == "inherit";
+    });
+
+    // collect selected footprints and their ancestors
+    std::set<std::string> needed;
+    for (auto& [name, value] : index.items()) {
+        if (!selection.matches(name))
+            continue;
+        std::string n = name;
+        while (!n.empty() && index.contains(n) && needed.insert(n).second)
+            n = index.at(n).value("inherit", std::string());
+    }
 
-            for (auto& [name, value] : j.items()) {
-                Footprint footprint;
+    // second pass: keep needed footprints
+    return parseJson(data, [&needed](int depth, json::parse_event_t event, json &parsed) {
+        return depth != 1 || event != json::parse_event_t::key || needed.contains(parsed.get<std::string>());
+    });
+}
 
-                try {
-                    readFootprint(value, footprints, footprint);
-                    footprints[name] = footprint;
-                } catch (std::exception &e) {
-                    // parsing the json file failed
-                    std::cerr << name << ": " << e.what() << std::endl;
-                }
+void readJson(const fs::path &path, const ResolvedCallback &resolved, const Selection &selection = Selection(),
+    const Limits &limits = Limits())
+{
+    // read config, compressed files get decompressed while parsing
+    auto input = openInput(path);
+    if (input != nullptr) {
+        auto &s = *input;
+        try {
+            json j;
+            if (selection.all()) {
+                ALLOC_SCOPE(Stage::PARSE, "json::parse");
+                j = json::parse(s,
+                    nullptr, // callback
+                    true, // allow exceptions
+                    true); // ignore comments
+            } else {
+                ALLOC_SCOPE(Stage::PARSE, "parseSelected");
+                std::string data((std::istreambuf_iterator<char>(s)), std::istreambuf_iterator<char>());
+                j = parseSelected(data, selection);
             }
+
+            ALLOC_SCOPE(Stage::INHERIT, "readFootprints");
+            readFootprints(j, resolved, limits);
         } catch (std::exception &e) {
             // parsing the json file failed
             std::cerr << "json: " << e.what() << std::endl;
@@ -493,112 +1036,88 @@ void readJson(const fs::path &path, std::map<std::string, Footprint> &footprints
 }
 
 // define a pad
-void writePad(std::ostream &s, std::string_view name, double2 position, double2 size, double shape, double2 drillSize, double2 padOffset, double clearance, double maskMargin, bool back) {
-    bool hasPad = size.positive();
-    bool hasDrill = drillSize.positive();
-
-    // pad
-    if (hasPad) {
-        s << "  (pad \"" << name << "\" ";
-        s << (hasDrill ? "thru_hole" : "smd");
-    } else {
-        // only hole
-        s << "  (pad \"\" np_thru_hole";
-        shape = CIRCLE;
-        size = drillSize;
+constexpr double mergeTolerance = 0.0005;
+
+// remove duplicate points and merge collinear segments
+void simplifyPath(std::vector<double2> &points, bool closed) {
+    std::vector<double2> result;
+    for (auto p : points) {
+        // drop degenerate segment
+        if (!result.empty() && length(p - result.back()) <= mergeTolerance)
+            continue;
+
+        // merge with previous segment if collinear and in same direction
+        int n = result.size();
+        if (n >= 2) {
+            double2 a = result[n - 1] - result[n - 2];
+            double2 b = p - result[n - 1];
+            if (std::abs(cross(a, b)) <= mergeTolerance * length(a + b) && dot(a, b) > 0)
+                result.pop_back();
+        }
+        result.push_back(p);
     }
 
-    // shape
-    if (shape <= RECT)
-        s << " rect";
-    else if (shape >= CIRCLE)
-        if (size.x == size.y)
-            s << " circle";
-        else
-            s << " oval";
-    else if (shape == ROUNDRECT)
-        s << " roundrect";
-    else
-        s << " roundrect (roundrect_rratio " << shape << ")";
-
-    // position/size
-    s << " (at " << position << ") (size " << size << ")";
-
-    // drill
-    if (hasDrill) {
-        s << " (drill ";
-        if (drillSize.x == drillSize.y)
-            s << drillSize.x;
-        else
-            s << "oval " << drillSize;
-        if (!padOffset.zero())
-            s << " (offset " << padOffset << ")";
-        s << ")";
+    if (closed) {
+        // remove closing point and merge across the start point
+        if (result.size() >= 2 && length(result.front() - result.back()) <= mergeTolerance)
+            result.pop_back();
+        for (int i = 0; i < 2 && result.size() >= 3; ++i) {
+            double2 a = result.back() - result[result.size() - 2];
+            double2 b = result.front() - result.back();
+            double2 c = result[1] - result.front();
+            if (std::abs(cross(a, b)) <= mergeTolerance * length(a + b) && dot(a, b) > 0)
+                result.pop_back();
+            else if (std::abs(cross(b, c)) <= mergeTolerance * length(b + c) && dot(b, c) > 0)
+                result.erase(result.begin());
+        }
     }
+    points = std::move(result);
+}
 
-    // margins
-    if (clearance > 0)
-        s << " (clearance " << clearance << ")";
-    if (maskMargin != 0)
-        s << " (solder_mask_margin " << maskMargin << ")";
-
-    // layers
-    const char *layers = hasDrill ? "*.Cu *.Mask" : (back ? "B.Cu B.Mask B.Paste" : "F.Cu F.Mask F.Paste");
-    s << " (layers " << layers << ")";
-    if (hasPad && hasDrill)
-        s << " (remove_unused_layers) (keep_end_layers)";
+// write path with the least number of primitives after merging collinear segments
+void writePath(Output &out, std::vector<double2> points, bool closed, double width, std::string_view layer) {
+    // an open path that ends at its start point is closed
+    if (!closed && points.size() >= 4 && length(points.front() - points.back()) <= mergeTolerance)
+        closed = true;
 
-    s << ')' << std::endl;
+    ALLOC_SCOPE(Stage::EMISSION, "writePath");
+    simplifyPath(points, closed);
+    if (points.size() >= 2)
+        out.path(points, closed, width, layer);
 }
 
-void writeLine(std::ostream &s, double2 p1, double2 p2, double width, std::string_view layer) {
-    s << "  (fp_line"
-        " (start " << p1 << ")"
-        " (end " << p2 << ")"
-        " (stroke (width " << width << ") (type solid))"
-        " (layer " << layer << ")"
-        ")" << std::endl;
+void writePath(Output &out, const clipper2::Path64 &path, bool closed, double width, std::string_view layer) {
+    std::vector<double2> points;
+    points.reserve(path.size());
+    for (auto &p : path) {
+        points.push_back(toPoint(p));
+    }
+    writePath(out, std::move(points), closed, width, layer);
 }
 
-// draw a rectangle to courtyard layer
-void writeRectangle(std::ostream &s, double2 center, double2 size, double width, std::string_view layer) {
+// draw a rectangle
+void writeRectangle(Output &out, double2 center, double2 size, double width, std::string_view layer) {
     double x1 = center.x - size.x * 0.5;
     double y1 = center.y - size.y * 0.5;
     double x2 = center.x + size.x * 0.5;
     double y2 = center.y + size.y * 0.5;
-    writeLine(s, {x1, y1}, {x2, y1}, width, layer);
-    writeLine(s, {x2, y1}, {x2, y2}, width, layer);
-    writeLine(s, {x2, y2}, {x1, y2}, width, layer);
-    writeLine(s, {x1, y2}, {x1, y1}, width, layer);
+    writePath(out, std::vector<double2>{{x1, y1}, {x2, y1}, {x2, y2}, {x1, y2}}, true, width, layer);
 }
 
 // write line consisting of multiple segments
-void writeLine(std::ostream &s, double2 position, const Footprint::Line &line) {
-    int segmentCount = line.points.size() - 1;
-    for (int i = 0; i < segmentCount; ++i) {
-        auto p1 = position + line.points[i];
-        auto p2 = position + line.points[i + 1];
-
-        s << "  (fp_line"
-            " (start " << p1 << ")"
-            " (end " << p2 << ")"
-            " (stroke (width " << line.width << ") (type solid))"
-            " (layer \"" << line.layer << "\")"
-            ")" << std::endl;
+void writeLine(Output &out, double2 position, const Footprint::Line &line) {
+    std::vector<double2> points;
+    points.reserve(line.points.size());
+    for (auto p : line.points) {
+        points.push_back(position + p);
     }
+    writePath(out, std::move(points), false, line.width, line.layer);
 }
 
 // write circle
-void writeCircle(std::ostream &s, double2 position, const Footprint::Circle &circle) {
-    auto p1 = position + circle.center;
-    auto p2 = p1 - double2(circle.radius, 0);
-    s << "  (fp_circle"
-        " (center " << p1 << ")"
-        " (end " << p2 << ")"
-        " (stroke (width " << circle.width << ") (type default))"
-        " (fill none)"
-        " (layer \"" << circle.layer << "\")"
-        ")" << std::endl;
+void writeCircle(Output &out, double2 position, const Footprint::Circle &circle) {
+    ALLOC_SCOPE(Stage::EMISSION, "writeCircle");
+    out.circle(position + circle.center, circle.radius, circle.width, circle.layer);
 }
 
 //(fp_circle (center -3 -3) (end -1 -3)
@@ -609,7 +1128,10 @@ constexpr double silkscreenWidth = 0.15;
 constexpr double silkscreenDistance = 0.1;
 constexpr double padClearance = 0.1;
 
-void addSilkscreenRectangle(clipper2::Clipper64 &clipper, double2 center, double2 size, Footprint::Orientation orientation) {
+// add silkscreen rectangle with gap at the pin 1 marker as open path and the marker as closed path
+void addSilkscreenRectangle(clipper2::Paths64 &openPaths, clipper2::Paths64 &closedPaths, double2 center, double2 size,
+    Footprint::Orientation orientation)
+{
     //size.x += silkscreenWidth + silkscreenDistance * 2;
     //size.y += silkscreenWidth + silkscreenDistance * 2;
     double x1 = center.x - size.x * 0.5;
@@ -632,7 +1154,7 @@ void addSilkscreenRectangle(clipper2::Clipper64 &clipper, double2 center, double
             path.push_back(toClipperPoint({x2, y2}));
             path.push_back(toClipperPoint({x1, y2}));
             path.push_back(toClipperPoint({x1, y}));
-            clipper.AddOpenSubject(paths);
+            openPaths.push_back(std::move(paths.front()));
         }
 
         xRef = x1;
@@ -649,7 +1171,7 @@ void addSilkscreenRectangle(clipper2::Clipper64 &clipper, double2 center, double
             path.push_back(toClipperPoint({x2, y1}));
             path.push_back(toClipperPoint({x2, y2}));
             path.push_back(toClipperPoint({x, y2}));
-            clipper.AddOpenSubject(paths);
+            openPaths.push_back(std::move(paths.front()));
         }
 
         xRef = x1;
@@ -666,42 +1188,598 @@ void addSilkscreenRectangle(clipper2::Clipper64 &clipper, double2 center, double
             path.push_back(toClipperPoint({x1, y2}));
             path.push_back(toClipperPoint({x1, y1}));
             path.push_back(toClipperPoint({x, y1}));
-            clipper.AddOpenSubject(paths);
+            openPaths.push_back(std::move(paths.front()));
         }
 
         xRef = x2;
         yRef = y1;
     }
 
-    // add pin1 indicator
-    {
-        clipper2::Paths64 paths;
-        clipper2::Path64 &path = paths.emplace_back();
-        double w = silkscreenWidth * 0.5;
-        path.push_back(toClipperPoint({xRef - w, yRef - w}));
-        path.push_back(toClipperPoint({xRef + w, yRef - w}));
-        path.push_back(toClipperPoint({xRef + w, yRef + w}));
-        path.push_back(toClipperPoint({xRef - w, yRef + w}));
-        clipper.AddSubject(paths);
+    // add pin1 indicator
+    {
+        clipper2::Paths64 paths;
+        clipper2::Path64 &path = paths.emplace_back();
+        double w = silkscreenWidth * 0.5;
+        path.push_back(toClipperPoint({xRef - w, yRef - w}));
+        path.push_back(toClipperPoint({xRef + w, yRef - w}));
+        path.push_back(toClipperPoint({xRef + w, yRef + w}));
+        path.push_back(toClipperPoint({xRef - w, yRef + w}));
+        closedPaths.push_back(std::move(paths.front()));
+    }
+}
+
+// silkscreen gets clipped in tiles if there are more clip paths (pads)
+constexpr int silkscreenTileClips = 512;
+constexpr double silkscreenTileSize = 5.0;
+
+// subtract the clips from the open and closed subjects in parallel. The open paths are split into tiles along their
+// segments, each tile only gets the clips that overlap it. The pieces are joined again in order
+void clipTiled(const clipper2::Paths64 &open, const clipper2::Paths64 &closed, const clipper2::Paths64 &clips,
+    clipper2::Paths64 &closedPaths, clipper2::Paths64 &openPaths)
+{
+    struct Tile {
+        clipper2::Path64 subject;
+        bool closed;
+        clipper2::Paths64 closedPaths = {};
+        clipper2::Paths64 openPaths = {};
+    };
+
+    // split open paths into tiles along the segments
+    std::vector<Tile> tiles;
+    int64_t tileSize = toClipperValue(silkscreenTileSize);
+    for (auto &path : open) {
+        for (size_t i = 0; i + 1 < path.size(); ++i) {
+            auto a = path[i];
+            auto b = path[i + 1];
+            double length = std::hypot(double(b.x - a.x), double(b.y - a.y));
+            int n = std::max(int(std::ceil(length / tileSize)), 1);
+            for (int k = 0; k < n; ++k) {
+                clipper2::Point64 p1 = {a.x + (b.x - a.x) * k / n, a.y + (b.y - a.y) * k / n};
+                clipper2::Point64 p2 = {a.x + (b.x - a.x) * (k + 1) / n, a.y + (b.y - a.y) * (k + 1) / n};
+                tiles.push_back({{p1, p2}, false});
+            }
+        }
+    }
+    for (auto &path : closed) {
+        tiles.push_back({path, true});
+    }
+
+    // grid index of the bounds of the clips in clipper units, clips that touch a tile count as overlapping
+    BoxIndex index(tileSize);
+    for (auto &clip : clips) {
+        auto b = clipper2::GetBounds(clip);
+        index.add({{double(b.left), double(b.top)}, {double(b.right), double(b.bottom)}});
+    }
+
+    parallelFor(int(tiles.size()), [&](int i) {
+        ALLOC_SCOPE(Stage::CLIPPING, "clipTiled");
+        auto &tile = tiles[i];
+        auto r = clipper2::GetBounds(tile.subject);
+        clipper2::Clipper64 clipper;
+        if (tile.closed)
+            clipper.AddSubject({tile.subject});
+        else
+            clipper.AddOpenSubject({tile.subject});
+        std::vector<int> indices;
+        index.query(Box{{double(r.left), double(r.top)}, {double(r.right), double(r.bottom)}}.expanded(1), indices);
+        clipper2::Paths64 tileClips;
+        for (int j : indices)
+            tileClips.push_back(clips[j]);
+        clipper.AddClip(tileClips);
+        clipper.Execute(clipper2::ClipType::Difference, clipper2::FillRule::NonZero, tile.closedPaths,
+            tile.openPaths);
+    }, 4);
+
+    // join the pieces in order
+    for (auto &tile : tiles) {
+        closedPaths.insert(closedPaths.end(), tile.closedPaths.begin(), tile.closedPaths.end());
+
+        // orient the pieces of a segment along the segment and sort them
+        auto a = tile.subject.front();
+        auto d = tile.subject.back();
+        auto along = [a, d](clipper2::Point64 p) {
+            return double(p.x - a.x) * double(d.x - a.x) + double(p.y - a.y) * double(d.y - a.y);
+        };
+        for (auto &piece : tile.openPaths) {
+            if (along(piece.front()) > along(piece.back()))
+                std::reverse(piece.begin(), piece.end());
+        }
+        std::sort(tile.openPaths.begin(), tile.openPaths.end(), [&along](auto &p, auto &q) {
+            return along(p.front()) < along(q.front());
+        });
+
+        // continue the previous path if the piece starts at its end
+        for (auto &piece : tile.openPaths) {
+            if (!openPaths.empty() && openPaths.back().back() == piece.front())
+                openPaths.back().insert(openPaths.back().end(), piece.begin() + 1, piece.end());
+            else
+                openPaths.push_back(std::move(piece));
+        }
+    }
+}
+
+// silkscreen clipping cache: results of clipping the silkscreen rectangle against the pad clip paths, both relative
+// to the silkscreen center. Least recently used entries get evicted when the stored points exceed the limit
+class SilkscreenClipCache {
+public:
+    using Result = std::pair<clipper2::Paths64, clipper2::Paths64>;
+
+    // hash of a key, the clips get translated by -offset on the fly instead of copying them
+    static uint64_t hash(clipper2::Point64 size, Footprint::Orientation orientation, const clipper2::Paths64 &clips,
+        clipper2::Point64 offset)
+    {
+        // FNV-1a over all coordinates
+        uint64_t h = 14695981039346656037ull;
+        auto add = [&h](int64_t v) {h = (h ^ uint64_t(v)) * 1099511628211ull;};
+        add(size.x);
+        add(size.y);
+        add(int(orientation));
+        for (auto &path : clips) {
+            add(path.size());
+            for (auto &p : path) {
+                add(p.x - offset.x);
+                add(p.y - offset.y);
+            }
+        }
+        return h;
+    }
+
+    // find a result and translate it by offset, returns false if not found
+    bool find(uint64_t h, clipper2::Point64 size, Footprint::Orientation orientation, const clipper2::Paths64 &clips,
+        clipper2::Point64 offset, clipper2::Paths64 &closedPaths, clipper2::Paths64 &openPaths)
+    {
+        std::lock_guard lock(this->mutex);
+        auto [begin, end] = this->index.equal_range(h);
+        for (auto it = begin; it != end; ++it) {
+            auto &entry = *it->second;
+            if (entry.size == size && entry.orientation == orientation && equal(entry.clips, clips, offset)) {
+                // move to front
+                this->entries.splice(this->entries.begin(), this->entries, it->second);
+                closedPaths = clipper2::TranslatePaths(entry.result.first, offset.x, offset.y);
+                openPaths = clipper2::TranslatePaths(entry.result.second, offset.x, offset.y);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // add a result, the clips are already relative to the center
+    void add(uint64_t h, clipper2::Point64 size, Footprint::Orientation orientation, clipper2::Paths64 clips,
+        Result result)
+    {
+        size_t points = count(clips) + count(result.first) + count(result.second);
+        if (points > MAX_POINTS / 16)
+            return;
+
+        std::lock_guard lock(this->mutex);
+        this->entries.push_front({h, size, orientation, std::move(clips), std::move(result), points});
+        this->index.emplace(h, this->entries.begin());
+        this->points += points;
+
+        // evict least recently used
+        while (this->points > MAX_POINTS) {
+            auto last = std::prev(this->entries.end());
+            auto [begin, end] = this->index.equal_range(last->hash);
+            for (auto it = begin; it != end; ++it) {
+                if (it->second == last) {
+                    this->index.erase(it);
+                    break;
+                }
+            }
+            this->points -= last->points;
+            this->entries.erase(last);
+        }
+    }
+
+private:
+    // limit of stored points (16 bytes each)
+    static constexpr size_t MAX_POINTS = 1 << 22;
+
+    struct Entry {
+        uint64_t hash;
+        clipper2::Point64 size;
+        Footprint::Orientation orientation;
+        clipper2::Paths64 clips;
+        Result result;
+        size_t points;
+    };
+
+    static size_t count(const clipper2::Paths64 &paths) {
+        size_t n = 0;
+        for (auto &path : paths)
+            n += path.size();
+        return n;
+    }
+
+    // compare relative clips with clips translated by -offset
+    static bool equal(const clipper2::Paths64 &a, const clipper2::Paths64 &b, clipper2::Point64 offset) {
+        if (a.size() != b.size())
+            return false;
+        for (size_t i = 0; i < a.size(); ++i) {
+            if (a[i].size() != b[i].size())
+                return false;
+            for (size_t k = 0; k < a[i].size(); ++k) {
+                if (a[i][k].x != b[i][k].x - offset.x || a[i][k].y != b[i][k].y - offset.y)
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    std::mutex mutex;
+    std::list<Entry> entries; // most recently used first
+    std::unordered_multimap<uint64_t, std::list<Entry>::iterator> index;
+    size_t points = 0;
+};
+
+// subtract the pads from the silkscreen rectangle. The results are cached so that footprints with the same silkscreen
+// and pads, e.g. variants of a family, don't run the clipper again
+void clipSilkscreen(double2 center, double2 size, Footprint::Orientation orientation, const clipper2::Paths64 &clips,
+    clipper2::Paths64 &closedPaths, clipper2::Paths64 &openPaths)
+{
+    static SilkscreenClipCache cache;
+    ALLOC_SCOPE(Stage::CLIPPING, "silkscreen");
+
+    // look up relative to the center
+    auto c = toClipperPoint(center);
+    auto s = toClipperPoint(size);
+    uint64_t h = SilkscreenClipCache::hash(s, orientation, clips, c);
+    if (cache.find(h, s, orientation, clips, c, closedPaths, openPaths))
+        return;
+
+    // run clipper outside of the lock, an other thread may calculate the same result concurrently
+    auto relative = clipper2::TranslatePaths(clips, -c.x, -c.y);
+    SilkscreenClipCache::Result result;
+    clipper2::Paths64 open;
+    clipper2::Paths64 closed;
+    addSilkscreenRectangle(open, closed, {0, 0}, size, orientation);
+    if (relative.size() < silkscreenTileClips) {
+        clipper2::Clipper64 clipper;
+        clipper.AddOpenSubject(open);
+        clipper.AddSubject(closed);
+        clipper.AddClip(relative);
+        clipper.Execute(clipper2::ClipType::Difference, clipper2::FillRule::NonZero, result.first, result.second);
+    } else {
+        clipTiled(open, closed, relative, result.first, result.second);
+    }
+
+    closedPaths = clipper2::TranslatePaths(result.first, c.x, c.y);
+    openPaths = clipper2::TranslatePaths(result.second, c.x, c.y);
+    cache.add(h, s, orientation, std::move(relative), std::move(result));
+}
+
+constexpr double outlineTolerance = 0.005;
+
+// add outline of a rounded rectangle, arcs are flattened so that the polygon encloses the exact shape
+void addRoundRect(clipper2::Path64 &path, double2 center, double2 size, double radius, const Affine &m = {}) {
+    double2 c = size * 0.5 - double2(radius, radius);
+
+    // angle step of arc segments so that the error stays below the tolerance
+    int n = 1;
+    if (radius > outlineTolerance) {
+        double maxStep = 2.0 * std::acos(1.0 - outlineTolerance / radius);
+        n = std::max(int(std::ceil(std::numbers::pi * 0.5 / maxStep)), 1);
+    }
+    double step = std::numbers::pi * 0.5 / n;
+    double r = radius / std::cos(step * 0.5);
+
+    // corners in counter clockwise order
+    const double2 corners[] = {{1, 1}, {-1, 1}, {-1, -1}, {1, -1}};
+    for (int i = 0; i < 4; ++i) {
+        double2 corner = center + c * corners[i];
+        if (radius <= 0) {
+            path.push_back(toClipperPoint(m(corner)));
+            continue;
+        }
+        for (int k = 0; k < n; ++k) {
+            double a = i * std::numbers::pi * 0.5 + (k + 0.5) * step;
+            path.push_back(toClipperPoint(m(corner + double2(std::cos(a), std::sin(a)) * r)));
+        }
+    }
+}
+
+// rounded rectangle, also used for circles, ovals and drills
+struct RoundRect {
+    double2 center;
+    double2 size;
+    double radius;
+
+    // direction of the x axis of the rotated rectangle
+    double2 axis = {1, 0};
+
+    bool rotated() const {return !(this->axis == double2(1, 0));}
+
+    // point relative to the center in the frame of the rectangle
+    double2 local(double2 p) const {
+        double2 d = p - this->center;
+        if (!rotated())
+            return d;
+        return {d.x * this->axis.x + d.y * this->axis.y, d.y * this->axis.x - d.x * this->axis.y};
+    }
+
+    // signed distance of a point to the outline (negative inside)
+    double distance(double2 p) const {
+        double2 d = local(p);
+        double qx = std::abs(d.x) - (this->size.x * 0.5 - this->radius);
+        double qy = std::abs(d.y) - (this->size.y * 0.5 - this->radius);
+        return length({std::max(qx, 0.0), std::max(qy, 0.0)}) + std::min(std::max(qx, qy), 0.0) - this->radius;
+    }
+};
+
+// get shapes of a pad and its drill (if not covered by the pad) including the silkscreen clearance relative to the
+// drill position. A rotated pad rotates around the drill position
+std::vector<RoundRect> getPadShapes(double2 size, double shape, double2 drill, double2 padOffset, double angle = 0) {
+    double d = silkscreenWidth * 0.5 + padClearance;
+    std::vector<RoundRect> shapes;
+    auto m = Affine::rotation(angle);
+
+    // pad
+    if (size.positive()) {
+        double radius = std::min(size.x, size.y) * std::clamp(shape, RECT, CIRCLE);
+        shapes.push_back({m(padOffset), size + double2(d, d) * 2.0, radius + d, m.x});
+    }
+
+    // drill (round or oval)
+    if (drill.positive() && (!padOffset.zero() || drill.x > size.x || drill.y > size.y))
+        shapes.push_back({{}, drill + double2(d, d) * 2.0, std::min(drill.x, drill.y) * 0.5 + d, m.x});
+
+    return shapes;
+}
+
+// get outline of a pad including the silkscreen clearance relative to the drill position. The outlines are built
+// once per unique pad geometry and cached for the whole run
+const clipper2::Paths64 &getPadOutline(double2 size, double shape, double2 drill, double2 padOffset, double angle) {
+    static std::map<std::array<double, 8>, clipper2::Paths64> cache;
+    static std::shared_mutex mutex;
+
+    // consecutive pads of an array have the same geometry, remember the last outline per thread so that pads written
+    // in parallel don't contend for the lock
+    thread_local std::array<double, 8> lastKey;
+    thread_local const clipper2::Paths64 *last = nullptr;
+    std::array<double, 8> key = {size.x, size.y, shape, drill.x, drill.y, padOffset.x, padOffset.y, angle};
+    if (last != nullptr && key == lastKey)
+        return *last;
+    lastKey = key;
+
+    // lookup with shared lock as most outlines are already built
+    {
+        std::shared_lock lock(mutex);
+        auto it = cache.find(key);
+        if (it != cache.end())
+            return *(last = &it->second);
+    }
+
+    // build outside of the lock
+    ALLOC_SCOPE(Stage::CLIPPING, "getPadOutline");
+    clipper2::Paths64 paths;
+    auto m = Affine::rotation(angle);
+    for (auto &roundRect : getPadShapes(size, shape, drill, padOffset)) {
+        addRoundRect(paths.emplace_back(), roundRect.center, roundRect.size, roundRect.radius, m);
+    }
+    if (paths.size() > 1)
+        paths = clipper2::Union(paths, clipper2::FillRule::NonZero);
+
+    std::unique_lock lock(mutex);
+    return *(last = &cache.try_emplace(key, std::move(paths)).first->second);
+}
+
+// add pad outline including clearance to the shapes that clip away the silkscreen
+inline void addSilkscreenPad(clipper2::Paths64 &paths, double2 center, double2 size, double shape, double2 drill,
+    double2 padOffset, double angle)
+{
+    auto c = toClipperPoint(center);
+    for (auto &outline : getPadOutline(size, shape, drill, padOffset, angle)) {
+        paths.push_back(clipper2::TranslatePath(outline, c.x, c.y));
+    }
+}
+
+
+constexpr double courtyardWidth = 0.05;
+constexpr double courtyardGrid = 0.01;
+
+inline void addRectangle(clipper2::Paths64 &paths, double2 center, double2 size, const Affine &m = {}) {
+    double x1 = center.x - size.x * 0.5;
+    double y1 = center.y - size.y * 0.5;
+    double x2 = center.x + size.x * 0.5;
+    double y2 = center.y + size.y * 0.5;
+
+    clipper2::Path64 &path = paths.emplace_back();
+    path.push_back(toClipperPoint(m({x1, y1})));
+    path.push_back(toClipperPoint(m({x2, y1})));
+    path.push_back(toClipperPoint(m({x2, y2})));
+    path.push_back(toClipperPoint(m({x1, y2})));
+}
+
+// shapes that get collected while writing the pads
+struct PadShapes {
+    // shapes that clip away the silkscreen
+    clipper2::Paths64 clips;
+
+    // exact shapes that clip away the silkscreen, used for arcs and circles
+    std::vector<RoundRect> roundRects;
+
+    // outlines of pads and drills, used for the courtyard
+    clipper2::Paths64 outlines;
+};
+
+// clip arc against the pad shapes analytically. Angles are in radians, returns the remaining pieces as pairs of start
+// angle and angle
+std::vector<std::pair<double, double>> clipArc(double2 center, double radius, double startAngle, double angle,
+    double width, const std::vector<RoundRect> &roundRects)
+{
+    ALLOC_SCOPE(Stage::CLIPPING, "clipArc");
+    constexpr double pi2 = 2.0 * std::numbers::pi;
+    if (angle < 0) {
+        startAngle += angle;
+        angle = -angle;
+    }
+    angle = std::min(angle, pi2);
+
+    // pad shapes include clearance for the default silkscreen width
+    double extra = (width - silkscreenWidth) * 0.5;
+
+    // collect angles where the arc crosses the outline of a pad shape. The crossings with a rotated shape are
+    // calculated in the frame of the shape and get rotated back by the angle of its axis
+    std::vector<double> cuts = {0, angle};
+    std::vector<const RoundRect *> relevant;
+    double rotation = 0;
+    auto add = [&](double a) {
+        double u = std::fmod(a + rotation - startAngle, pi2);
+        if (u < 0)
+            u += pi2;
+        if (u < angle)
+            cuts.push_back(u);
+    };
+    double2 c;
+    auto addCircle = [&](double2 p, double r) {
+        double2 v = p - c;
+        double d = length(v);
+        if (d == 0 || d > radius + r || d < std::abs(radius - r))
+            return;
+        double base = std::atan2(v.y, v.x);
+        double delta = std::acos(std::clamp((radius * radius - r * r + d * d) / (2.0 * d * radius), -1.0, 1.0));
+        add(base - delta);
+        add(base + delta);
+    };
+    for (auto &roundRect : roundRects) {
+        // skip if the whole circle is outside
+        if (roundRect.distance(center) - extra >= radius)
+            continue;
+        relevant.push_back(&roundRect);
+
+        // center of the arc in the frame of the shape
+        c = center;
+        rotation = 0;
+        if (roundRect.rotated()) {
+            c = roundRect.center + roundRect.local(center);
+            rotation = std::atan2(roundRect.axis.y, roundRect.axis.x);
+        }
+
+        double r = std::max(roundRect.radius + extra, 0.0);
+        double2 h = roundRect.size * 0.5 + double2(extra, extra);
+        double2 inner = h - double2(r, r);
+        for (double sign : {-1.0, 1.0}) {
+            // straight edges
+            double dx = (roundRect.center.x + sign * h.x - c.x) / radius;
+            if (std::abs(dx) <= 1.0) {
+                add(std::acos(dx));
+                add(-std::acos(dx));
+            }
+            double dy = (roundRect.center.y + sign * h.y - c.y) / radius;
+            if (std::abs(dy) <= 1.0) {
+                add(std::asin(dy));
+                add(std::numbers::pi - std::asin(dy));
+            }
+
+            // rounded corners
+            if (r > 0) {
+                addCircle(roundRect.center + double2(sign * inner.x, inner.y), r);
+                addCircle(roundRect.center + double2(sign * inner.x, -inner.y), r);
+            }
+        }
+    }
+    std::sort(cuts.begin(), cuts.end());
+
+    // keep pieces whose midpoint is outside of all pad shapes
+    std::vector<std::pair<double, double>> pieces;
+    bool join = false;
+    for (int i = 0; i < int(cuts.size()) - 1; ++i) {
+        double u1 = cuts[i];
+        double u2 = cuts[i + 1];
+        if (u2 - u1 <= 1e-9)
+            continue;
+        double a = startAngle + (u1 + u2) * 0.5;
+        double2 p = center + double2(std::cos(a), std::sin(a)) * radius;
+        bool inside = false;
+        for (auto roundRect : relevant) {
+            if (roundRect->distance(p) < extra) {
+                inside = true;
+                break;
+            }
+        }
+        if (inside) {
+            join = false;
+        } else if (join) {
+            pieces.back().second = u2 - pieces.back().first;
+        } else {
+            pieces.emplace_back(u1, u2 - u1);
+            join = true;
+        }
+    }
+
+    // join first and last piece of a circle
+    if (angle == pi2 && pieces.size() >= 2 && pieces.front().first == 0
+        && pieces.back().first + pieces.back().second == pi2)
+    {
+        pieces.back().second += pieces.front().second;
+        pieces.erase(pieces.begin());
+    }
+
+    for (auto &piece : pieces) {
+        piece.first += startAngle;
+    }
+    return pieces;
+}
+
+// write arc or circle, clipped by the pads if on the silkscreen layer
+void writeArc(Output &out, double2 center, double radius, double startAngle, double angle, double width,
+    std::string_view layer, const PadShapes &shapes)
+{
+    if (layer != "F.SilkS") {
+        out.arc(center, radius, startAngle, angle, width, layer);
+        return;
+    }
+    for (auto [a, b] : clipArc(center, radius, startAngle, angle, width, shapes.roundRects)) {
+        out.arc(center, radius, a, b, width, layer);
+    }
+}
+
+// add a pad to the silkscreen clips and courtyard outlines
+void addPad(PadShapes &shapes, double2 position, double2 size, double shape, double2 drill, double2 padOffset,
+    double angle)
+{
+    addSilkscreenPad(shapes.clips, position, size, shape, drill, padOffset, angle);
+    for (auto roundRect : getPadShapes(size, shape, drill, padOffset, angle)) {
+        roundRect.center += position;
+        shapes.roundRects.push_back(roundRect);
     }
+
+    auto m = Affine::rotation(angle, position);
+    if (size.positive())
+        addRectangle(shapes.outlines, position + padOffset, size, m);
+    if (drill.positive())
+        addRectangle(shapes.outlines, position, drill, m);
 }
 
-inline void addSilkscreenPad(clipper2::Paths64 &paths, double2 center, double2 size, double2 drill) {
-    size.x = std::max(size.x, drill.x);
-    size.y = std::max(size.y, drill.y);
-    size.x += silkscreenWidth + padClearance * 2;
-    size.y += silkscreenWidth + padClearance * 2;
-    double x1 = center.x - size.x * 0.5;
-    double y1 = center.y + size.y * 0.5;
-    double x2 = center.x + size.x * 0.5;
-    double y2 = center.y - size.y * 0.5;
+// calculate courtyard as union of body rectangle and pad outlines that are enlarged by the margin
+clipper2::Paths64 getCourtyard(double2 center, double2 size, const clipper2::Paths64 &outlines, double margin) {
+    ALLOC_SCOPE(Stage::CLIPPING, "getCourtyard");
+    // enlarge all pads in one pass
+    clipper2::Paths64 paths = clipper2::InflatePaths(outlines, margin * clipperFactor,
+        clipper2::JoinType::Miter, clipper2::EndType::Polygon);
 
-    clipper2::Path64 path;
-    path.push_back(toClipperPoint({x1, y1}));
-    path.push_back(toClipperPoint({x2, y1}));
-    path.push_back(toClipperPoint({x2, y2}));
-    path.push_back(toClipperPoint({x1, y2}));
-    paths.push_back(path);
+    // body
+    if (size.positive())
+        addRectangle(paths, center, size);
+
+    // merge all in one pass
+    paths = clipper2::Union(paths, clipper2::FillRule::NonZero);
+
+    // snap to grid, away from the center so that the courtyard does not shrink
+    int64_t grid = toClipperValue(courtyardGrid);
+    auto c = toClipperPoint(center);
+    auto snap = [grid](int64_t v, int64_t c) {
+        int64_t d = v - c;
+        int64_t r = (std::abs(d) + grid - 1) / grid * grid;
+        return c + (d < 0 ? -r : r);
+    };
+    for (auto &path : paths) {
+        for (auto &p : path) {
+            p.x = snap(p.x, c.x / grid * grid);
+            p.y = snap(p.y, c.y / grid * grid);
+        }
+    }
+    return paths;
 }
 
 
@@ -726,21 +1804,16 @@ void silkscreenRectangle(std::ofstream &s, double2 center, double2 size) {
     line(s, {x1, y2}, {x1, y}, silkscreenWidth, "F.SilkS");
 }*/
 
-void writeSilkscreenPaths(std::ostream &s, const clipper2::Paths64 &paths, int open = 0) {
+void writeSilkscreenPaths(Output &out, const clipper2::Paths64 &paths, bool closed = true) {
     for (auto &path : paths) {
-        int count = path.size();
-        for (int i = 0; i < count - open; ++i) {
-            auto p1 = toPoint(path[i]);
-            auto p2 = toPoint(path[(i + 1) % count]);
-            writeLine(s, p1, p2, silkscreenWidth, "F.SilkS");
-        }
+        writePath(out, path, closed, silkscreenWidth, "F.SilkS");
     }
 }
 
 constexpr double fabWidth = 0.15;
 constexpr double fabDistance = 0.2;
 
-void writeFabRectangle(std::ofstream &s, double2 center, double2 size) {
+void writeFabRectangle(Output &out, double2 center, double2 size) {
     double x1 = center.x - size.x * 0.5;
     double y1 = center.y + size.y * 0.5;
     double x2 = center.x + size.x * 0.5;
@@ -750,14 +1823,88 @@ void writeFabRectangle(std::ofstream &s, double2 center, double2 size) {
     double x = x1 + (x2 > x1 ? d : -d);
     double y = y1 + (y2 > y1 ? d : -d);
 
-    writeLine(s, {x, y1}, {x1, y}, silkscreenWidth, "F.Fab");
-    writeLine(s, {x, y1}, {x2, y1}, silkscreenWidth, "F.Fab");
-    writeLine(s, {x2, y1}, {x2, y2}, silkscreenWidth, "F.Fab");
-    writeLine(s, {x2, y2}, {x1, y2}, silkscreenWidth, "F.Fab");
-    writeLine(s, {x1, y2}, {x1, y}, silkscreenWidth, "F.Fab");
+    writePath(out, std::vector<double2>{{x, y1}, {x2, y1}, {x2, y2}, {x1, y2}, {x1, y}}, true, silkscreenWidth, "F.Fab");
+}
+
+// pad at its final position, the pads of all pad arrays are collected before they get written
+struct PlacedPad {
+    std::string name;
+    double2 position;
+    double2 size;
+    double shape;
+    double2 drillSize;
+    double2 padOffset;
+    double clearance;
+    double maskMargin;
+    bool back;
+    double angle = 0;
+};
+
+inline void placePad(std::vector<PlacedPad> &pads, std::string name, double2 position, double2 size, double shape,
+    double2 drillSize, double2 padOffset, double clearance, double maskMargin, bool back)
+{
+    pads.push_back({std::move(name), position, size, shape, drillSize, padOffset, clearance, maskMargin, back});
+}
+
+// rotate placed pads around a center, the pads themselves get rotated by the same angle. The positions are
+// transformed in one batch
+void rotatePads(PlacedPad *begin, PlacedPad *end, double2 center, double angle) {
+    std::vector<double2> positions;
+    positions.reserve(end - begin);
+    for (auto pad = begin; pad != end; ++pad)
+        positions.push_back(pad->position);
+    transform(Affine::rotation(angle, center), positions.data(), positions.size());
+    for (auto pad = begin; pad != end; ++pad) {
+        pad->position = positions[pad - begin];
+        pad->angle = normalizeAngle(pad->angle + angle);
+    }
+}
+
+// footprints with more pads get written in chunks in parallel
+constexpr int padChunkSize = 256;
+
+// write pads and add them to the shapes. Chunks of pads are written into copies of the output and the shapes of each
+// chunk are collected separately, then both are joined in order so that the result does not depend on the threads
+void writePads(Output &out, const std::vector<PlacedPad> &pads, PadShapes &shapes) {
+    // the pads of a chunk go to the output in one batch so that their positions get transformed together
+    auto write = [](Output &out, PadShapes &shapes, const PlacedPad *begin, const PlacedPad *end) {
+        std::vector<PadInfo> infos;
+        infos.reserve(end - begin);
+        for (auto pad = begin; pad != end; ++pad) {
+            infos.push_back({pad->name, pad->position, pad->size, pad->shape, pad->drillSize, pad->padOffset,
+                pad->clearance, pad->maskMargin, pad->back, pad->angle});
+            addPad(shapes, pad->position, pad->size, pad->shape, pad->drillSize, pad->padOffset, pad->angle);
+        }
+        ALLOC_SCOPE(Stage::EMISSION, "writePads");
+        out.pads(infos.data(), infos.size());
+    };
+
+    int count = pads.size();
+    int chunkCount = (count + padChunkSize - 1) / padChunkSize;
+    if (chunkCount <= 1) {
+        write(out, shapes, pads.data(), pads.data() + count);
+        return;
+    }
+
+    std::vector<Output> outputs(chunkCount, out);
+    std::vector<PadShapes> chunkShapes(chunkCount);
+    parallelFor(chunkCount, [&](int i) {
+        ALLOC_SCOPE(Stage::PADS, "writePads");
+        int begin = i * padChunkSize;
+        int end = std::min(begin + padChunkSize, count);
+        write(outputs[i], chunkShapes[i], pads.data() + begin, pads.data() + end);
+    }, 1);
+
+    for (int i = 0; i < chunkCount; ++i) {
+        out.join(outputs[i]);
+        auto &chunk = chunkShapes[i];
+        shapes.clips.insert(shapes.clips.end(), chunk.clips.begin(), chunk.clips.end());
+        shapes.roundRects.insert(shapes.roundRects.end(), chunk.roundRects.begin(), chunk.roundRects.end());
+        shapes.outlines.insert(shapes.outlines.end(), chunk.outlines.begin(), chunk.outlines.end());
+    }
 }
 
-void writeSingle(std::ofstream &s, const Footprint &footprint, const Footprint::Pad &pad, clipper2::Paths64 &clips) {
+void writeSingle(std::vector<PlacedPad> &pads, const Footprint &footprint, const Footprint::Pad &pad) {
     int count = pad.count;
     bool hasPad = pad.size.positive();
     bool hasDrill = pad.drillSize.positive();
@@ -806,16 +1953,13 @@ void writeSingle(std::ofstream &s, const Footprint &footprint, const Footprint::
         }
 
         if (pad.exists(n)) {
-            writePad(s, pad.getName(n), position, pad.size, pad.shape, pad.drillSize, padOffset, pad.clearance, pad.maskMargin, pad.back);
-            addSilkscreenPad(clips, position, pad.size, pad.drillSize);
+            placePad(pads, pad.getName(n), position, pad.size, pad.shape, pad.drillSize, padOffset, pad.clearance, pad.maskMargin, pad.back);
         }
         position += pitch;
     }
 }
 
-void writeDual(std::ofstream &s, const Footprint &footprint, const Footprint::Pad &pad,
-    clipper2::Paths64 &clips)
-{
+void writeDual(std::vector<PlacedPad> &pads, const Footprint &footprint, const Footprint::Pad &pad) {
     int count = pad.count / 2;
     bool hasPad = pad.size.positive();
     bool hasDrill = pad.drillSize.positive();
@@ -890,14 +2034,12 @@ void writeDual(std::ofstream &s, const Footprint &footprint, const Footprint::Pa
 
         // first row
         if (pad.exists(n1)) {
-            writePad(s, pad.getName(n1), position1, pad.size, pad.shape, pad.drillSize, padOffset1, pad.clearance, pad.maskMargin, pad.back);
-            addSilkscreenPad(clips, position1, pad.size, pad.drillSize);
+            placePad(pads, pad.getName(n1), position1, pad.size, pad.shape, pad.drillSize, padOffset1, pad.clearance, pad.maskMargin, pad.back);
         }
 
         // second row
         if (pad.exists(n2)) {
-            writePad(s, pad.getName(n2), position2, pad.size, pad.shape, pad.drillSize, padOffset2, pad.clearance, pad.maskMargin, pad.back);
-            addSilkscreenPad(clips, position2, pad.size, pad.drillSize);
+            placePad(pads, pad.getName(n2), position2, pad.size, pad.shape, pad.drillSize, padOffset2, pad.clearance, pad.maskMargin, pad.back);
         }
 
         // increment position
@@ -915,7 +2057,7 @@ double2 swap(double2 p) {
 }
 
 // write quad (e.g. QFP)
-void writeQuad(std::ofstream &s, double2 globalPosition, const Footprint::Pad &pad, clipper2::Paths64 &clips) {
+void writeQuad(std::vector<PlacedPad> &pads, double2 globalPosition, const Footprint::Pad &pad) {
     int count = pad.count / 4;
     bool hasPad = pad.size.positive();
     bool hasDrill = pad.drillSize.positive();
@@ -962,20 +2104,16 @@ void writeQuad(std::ofstream &s, double2 globalPosition, const Footprint::Pad &p
         int n4 = count * 3 + index;
 
         if (pad.exists(n1)) {
-            writePad(s, pad.getName(n1), position1, pad.size, pad.shape, pad.drillSize, padOffset1, pad.clearance, pad.maskMargin, pad.back);
-            addSilkscreenPad(clips, position1, pad.size, pad.drillSize);
+            placePad(pads, pad.getName(n1), position1, pad.size, pad.shape, pad.drillSize, padOffset1, pad.clearance, pad.maskMargin, pad.back);
         }
         if (pad.exists(n2)) {
-            writePad(s, pad.getName(n2), position2, padSize24, pad.shape, swap(pad.drillSize), padOffset2, pad.clearance, pad.maskMargin, pad.back);
-            addSilkscreenPad(clips, position2, padSize24, pad.drillSize);
+            placePad(pads, pad.getName(n2), position2, padSize24, pad.shape, swap(pad.drillSize), padOffset2, pad.clearance, pad.maskMargin, pad.back);
         }
         if (pad.exists(n3)) {
-            writePad(s, pad.getName(n3), position3, pad.size, pad.shape, pad.drillSize, padOffset3, pad.clearance, pad.maskMargin, pad.back);
-            addSilkscreenPad(clips, position3, pad.size, pad.drillSize);
+            placePad(pads, pad.getName(n3), position3, pad.size, pad.shape, pad.drillSize, padOffset3, pad.clearance, pad.maskMargin, pad.back);
         }
         if (pad.exists(n4)) {
-            writePad(s, pad.getName(n4), position4, padSize24, pad.shape, swap(pad.drillSize), padOffset4, pad.clearance, pad.maskMargin, pad.back);
-            addSilkscreenPad(clips, position4, padSize24, pad.drillSize);
+            placePad(pads, pad.getName(n4), position4, padSize24, pad.shape, swap(pad.drillSize), padOffset4, pad.clearance, pad.maskMargin, pad.back);
         }
 
         // increment position
@@ -988,11 +2126,147 @@ void writeQuad(std::ofstream &s, double2 globalPosition, const Footprint::Pad &p
 }
 
 // generate grid (e.g. BGA)
-void writeGrid(std::ofstream &s, double2 globalPosition, const Footprint::Pad &pad, clipper2::Paths64 &clips) {
+void writeGrid(std::vector<PlacedPad> &pads, double2 globalPosition, const Footprint::Pad &pad) {
+
+}
+
+constexpr double textSize = 1.0;
+constexpr double textThickness = 0.15;
+constexpr double textGap = 0.2;
+constexpr double textStep = 0.25;
+constexpr int textMaxRings = 40;
+
+// get size of a text in the KiCad stroke font (estimated from the average character width)
+double2 getTextSize(std::string_view text) {
+    return {text.size() * textSize * 0.8 + textThickness, textSize + textThickness};
+}
+
+// find the position of a text nearest to the preferred position (on top or bottom of the outline) where the text
+// clears the geometry in the index. The candidates lie on rectangles around the outline with increasing distance
+double2 placeText(const BoxIndex &index, const Box &outline, bool top, double2 size) {
+    double2 half = size * 0.5;
+    double cx = (outline.min.x + outline.max.x) * 0.5;
+    double cy = (outline.min.y + outline.max.y) * 0.5;
+    double2 preferred = {cx, top ? outline.min.y - half.y - textGap : outline.max.y + half.y + textGap};
+
+    double2 best = preferred;
+    double bestDistance = std::numeric_limits<double>::max();
+    for (int ring = 0; ring < textMaxRings; ++ring) {
+        double d = ring * textStep;
+
+        // no further ring can contain a nearer candidate
+        if (bestDistance <= d)
+            break;
+
+        // rectangle of candidate centers
+        Box r = outline.expanded(textGap + d);
+        r.min -= half;
+        r.max += half;
+
+        auto check = [&](double2 c) {
+            c = {std::round(c.x * 1000.0) * 0.001 + 0.0, std::round(c.y * 1000.0) * 0.001 + 0.0};
+            double distance = length(c - preferred);
+            if (distance < bestDistance && !index.intersects(Box::centered(c, size).expanded(textGap))) {
+                best = c;
+                bestDistance = distance;
+            }
+        };
+
+        // top and bottom edges, starting at the center
+        int nx = int((r.max.x - r.min.x) * 0.5 / textStep);
+        for (int i = -nx; i <= nx; ++i) {
+            check({cx + i * textStep, r.min.y});
+            check({cx + i * textStep, r.max.y});
+        }
+
+        // left and right edges
+        int ny = int((r.max.y - r.min.y) * 0.5 / textStep);
+        for (int i = -ny; i <= ny; ++i) {
+            check({r.min.x, cy + i * textStep});
+            check({r.max.x, cy + i * textStep});
+        }
+    }
+    return best;
+}
+
+// bounding box of a rectangle at an offset from a position that is rotated around the position
+Box rotatedBox(double2 position, double2 offset, double2 size, double angle) {
+    if (angle == 0)
+        return Box::centered(position + offset, size);
+    auto m = Affine::rotation(angle, position);
+    double2 h = size * 0.5;
+    Box box = {{1e9, 1e9}, {-1e9, -1e9}};
+    for (double2 corner : {double2(-h.x, -h.y), double2(h.x, -h.y), double2(h.x, h.y), double2(-h.x, h.y)}) {
+        double2 p = m(position + offset + corner);
+        box.include({p, p});
+    }
+    return box;
+}
+
+// place reference text above and value text below the courtyard where they don't collide with pads and silkscreen
+void placeTexts(const Footprint &footprint, std::string_view name, double2 position, double2 silkscreenSize,
+    double2 courtyardSize, const std::vector<PlacedPad> &pads, double2 &refPosition, double2 &valuePosition)
+{
+    BoxIndex index;
+
+    // outline of body and pads
+    Box outline = {{1e9, 1e9}, {-1e9, -1e9}};
+    if (courtyardSize.positive())
+        outline.include(Box::centered(position, courtyardSize));
+    double margin = footprint.courtyard ? footprint.courtyardMargin : 0;
+    for (auto &pad : pads) {
+        if (pad.size.positive()) {
+            auto box = rotatedBox(pad.position, pad.padOffset, pad.size, pad.angle);
+            index.add(box);
+            outline.include(box.expanded(margin));
+        }
+        if (pad.drillSize.positive()) {
+            auto box = rotatedBox(pad.position, {}, pad.drillSize, pad.angle);
+            index.add(box);
+            outline.include(box.expanded(margin));
+        }
+    }
+    if (outline.empty())
+        outline = {position, position};
+
+    // silkscreen
+    if (silkscreenSize.positive()) {
+        auto box = Box::centered(position, silkscreenSize);
+        double2 corners[] = {box.min, {box.max.x, box.min.y}, box.max, {box.min.x, box.max.y}};
+        for (int i = 0; i < 4; ++i)
+            index.add(Box::segment(corners[i], corners[(i + 1) & 3], silkscreenWidth));
+    }
+    for (auto &line : footprint.lines) {
+        if (line.layer != "F.SilkS")
+            continue;
+        for (size_t i = 0; i + 1 < line.points.size(); ++i) {
+            index.add(Box::segment(footprint.position + line.points[i], footprint.position + line.points[i + 1],
+                line.width));
+        }
+    }
+    for (auto &circle : footprint.circles) {
+        double d = circle.radius * 2.0 + circle.width;
+        if (circle.layer == "F.SilkS")
+            index.add(Box::centered(footprint.position + circle.center, {d, d}));
+    }
+    for (auto &arc : footprint.arcs) {
+        // whole circle of the arc
+        double d = arc.radius * 2.0 + arc.width;
+        if (arc.layer == "F.SilkS")
+            index.add(Box::centered(footprint.position + arc.center, {d, d}));
+    }
 
+    // reference on top, value on bottom
+    double2 refSize = getTextSize("REF**");
+    refPosition = placeText(index, outline, true, refSize);
+    index.add(Box::centered(refPosition, refSize));
+    valuePosition = placeText(index, outline, false, getTextSize(name));
 }
 
-bool generateFootprint(const fs::path &path, const std::string &name, const Footprint &footprint) {
+// suffix of the name of back side variants
+constexpr const char *backSuffix = "_Back";
+
+bool generateFootprint(Output &out, const fs::path &path, const std::string &name, const Footprint &footprint) {
     double2 position = footprint.position + footprint.offset.xy();
 
     auto bodySize =  footprint.body.xy();
@@ -1002,10 +2276,7 @@ bool generateFootprint(const fs::path &path, const std::string &name, const Foot
     bool haveSilkscreen = footprint.silkscreen && silkscreenSize.positive();
 
     double2 courtyardSize = bodySize + footprint.courtyardAdd;
-    bool haveCourtyard = footprint.courtyard && courtyardSize.positive();
 
-    double2 refPosition = {0, 0};
-    double2 valuePosition = {0, 0};
     double maskMargin = 0;
     double pasteMargin = 0;
 
@@ -1016,23 +2287,57 @@ bool generateFootprint(const fs::path &path, const std::string &name, const Foot
         silkscreenSize.x *= -1;
     }
 
+    // place pads
+    std::vector<PlacedPad> pads;
+    for (auto &pad : footprint.pads) {
+        ALLOC_SCOPE(Stage::PADS, "pads");
+        int first = pads.size();
+        switch (pad.type) {
+        case Footprint::Pad::Type::SINGLE:
+            writeSingle(pads, footprint, pad);
+            break;
+        case Footprint::Pad::Type::DUAL:
+            writeDual(pads, footprint, pad);
+            break;
+        case Footprint::Pad::Type::QUAD:
+            writeQuad(pads, footprint.position, pad);
+            break;
+        case Footprint::Pad::Type::GRID:
+            writeGrid(pads, footprint.position, pad);
+            break;
+        }
+
+        // rotate the pads of the array around its position
+        if (pad.rotation != 0) {
+            rotatePads(pads.data() + first, pads.data() + pads.size(), footprint.position + pad.position,
+                pad.rotation);
+        }
+    }
+
+    // place reference and value texts
+    double2 refPosition;
+    double2 valuePosition;
+    placeTexts(footprint, name, position, haveSilkscreen ? silkscreenSize : double2(), courtyardSize, pads,
+        refPosition, valuePosition);
+
+
+    // rotation of the whole footprint is applied by the output stage
+    if (footprint.rotation != 0)
+        out.setTransform(Affine::rotation(footprint.rotation));
 
-    std::ofstream s((path / (name + ".kicad_mod")).string());
+    // the back side variant gets mirrored from the same geometry by the output stage
+    if (footprint.backVariant)
+        out.setBackVariant(name + backSuffix);
 
     // header
-    s << "(module " << name << " (layer F.Cu) (tedit 5EC043C1)" << std::endl;
-    s << "  (descr \"" << footprint.description << "\")" << std::endl;
-    s << "  (attr " << (footprint.getType() == Footprint::Type::THROUGH_HOLE ? "through_hole" : "smd") << ')' << std::endl;
-    if (haveBody)
-        s << "  (model \"" << name << ".wrl\" (at (xyz 0 0 0)) (scale (xyz 1 1 1)) (rotate (xyz 0 0 0)))" << std::endl;
-    s << "  (fp_text reference REF** (at " << refPosition << ") (layer F.SilkS) (effects (font (size 1 1) (thickness 0.15))))" << std::endl;
-    s << "  (fp_text value " << name << " (at " << valuePosition << ") (layer F.Fab) (effects (font (size 1 1) (thickness 0.15))))" << std::endl;
-    s << "  (solder_mask_margin " << maskMargin << ")" << std::endl;
-    s << "  (solder_paste_margin " << pasteMargin << ")" << std::endl;
-
-    // clipper for silkscreen
-    clipper2::Clipper64 clipper;
-    clipper2::Paths64 clips; // shapes that clip away the silkscreen, e.g. pads
+    FootprintInfo info = {name, footprint.description, footprint.getType() == Footprint::Type::THROUGH_HOLE,
+        haveBody, refPosition, valuePosition, maskMargin, pasteMargin};
+    {
+        ALLOC_SCOPE(Stage::EMISSION, "begin");
+        out.begin(path, info);
+    }
+
+    PadShapes shapes; // shapes that clip away the silkscreen, e.g. pads
 
     // body
     if (haveBody) {
@@ -1046,7 +2351,7 @@ bool generateFootprint(const fs::path &path, const std::string &name, const Foot
 
 
         // fabrication layer
-        writeFabRectangle(s, position, bodySize);
+        writeFabRectangle(out, position, bodySize);
 
         // add silkscreen rectangle
         //if (footprint.silkscreen) {
@@ -1054,57 +2359,57 @@ bool generateFootprint(const fs::path &path, const std::string &name, const Foot
         //}
     }
 
-    if (haveSilkscreen)
-        addSilkscreenRectangle(clipper, position, silkscreenSize, footprint.orientation);
-
-    // courtyard
-    if (haveCourtyard)
-        writeRectangle(s, position, courtyardSize, 0.05, "F.CrtYd");
-
     // pads
-    for (auto &pad : footprint.pads) {
-        switch (pad.type) {
-        case Footprint::Pad::Type::SINGLE:
-            writeSingle(s, footprint, pad, clips);
-            break;
-        case Footprint::Pad::Type::DUAL:
-            writeDual(s, footprint, pad, clips);
-            break;
-        case Footprint::Pad::Type::QUAD:
-            writeQuad(s, footprint.position, pad, clips);
-            break;
-        case Footprint::Pad::Type::GRID:
-            writeGrid(s, footprint.position, pad, clips);
-            break;
+    writePads(out, pads, shapes);
+
+    // courtyard (union of body and pads)
+    if (footprint.courtyard) {
+        auto courtyard = getCourtyard(position, courtyardSize, shapes.outlines, footprint.courtyardMargin);
+        for (auto &path : courtyard) {
+            writePath(out, path, true, courtyardWidth, "F.CrtYd");
         }
     }
 
     // lines
     for (auto &line : footprint.lines) {
-        writeLine(s, footprint.position, line);
+        writeLine(out, footprint.position, line);
     }
 
     // circles
     for (auto &circle : footprint.circles) {
-        writeCircle(s, footprint.position, circle);
+        // write as arcs if the circle is clipped by the pads
+        if (circle.layer == "F.SilkS") {
+            auto center = footprint.position + circle.center;
+            auto pieces = clipArc(center, circle.radius, 0, 2.0 * std::numbers::pi, circle.width, shapes.roundRects);
+            if (pieces.size() != 1 || pieces.front().second < 2.0 * std::numbers::pi) {
+                for (auto [a, b] : pieces) {
+                    out.arc(center, circle.radius, a, b, circle.width, circle.layer);
+                }
+                continue;
+            }
+        }
+        writeCircle(out, footprint.position, circle);
+    }
+
+    // arcs
+    for (auto &arc : footprint.arcs) {
+        writeArc(out, footprint.position + arc.center, arc.radius, arc.startAngle * std::numbers::pi / 180.0,
+            arc.angle * std::numbers::pi / 180.0, arc.width, arc.layer, shapes);
     }
 
     // silkscreen
     if (haveSilkscreen) {
-        clipper.AddClip(clips);
-
         // subtract pads from silkscreen
-        clipper2::Paths64 closedPahts;
+        clipper2::Paths64 closedPaths;
         clipper2::Paths64 openPaths;
-        clipper.Execute(clipper2::ClipType::Difference, clipper2::FillRule::NonZero, closedPahts, openPaths);
-        writeSilkscreenPaths(s, closedPahts);
-        writeSilkscreenPaths(s, openPaths, 1);
+        clipSilkscreen(position, silkscreenSize, footprint.orientation, shapes.clips, closedPaths, openPaths);
+        writeSilkscreenPaths(out, closedPaths);
+        writeSilkscreenPaths(out, openPaths, false);
     }
 
     // footer
-    s << ")" << std::endl;
-
-    s.close();
+    ALLOC_SCOPE(Stage::EMISSION, "end");
+    out.end();
 
     // return true when vrml should be generated
     return haveBody;
@@ -1112,7 +2417,8 @@ bool generateFootprint(const fs::path &path, const std::string &name, const Foot
 
 // generate a box as vrml as minimalistic 3D visualization
 void generateVrml(const fs::path &path, const std::string &name, const Footprint &footprint) {
-    std::ofstream s((path / (name + ".wrl")).string());
+    ALLOC_SCOPE(Stage::VRML, "generateVrml");
+    std::ostringstream s;
 
     // center of box
     double3 center = footprint.offset + double3(footprint.position.x, footprint.position.y, 0);
@@ -1140,11 +2446,14 @@ Shape {
         coordIndex [3,0,2,-1,3,1,0,-1,6,5,7,-1,6,4,5,-1,1,4,0,-1,1,5,4,-1,7,2,6,-1,7,3,2,-1,2,4,6,-1,2,0,4,-1,7,1,3,-1,7,5,1]
         coord Coordinate {point [)vrml";
 
+    // rotation of the footprint, counter-clockwise is negative in board coordinates because the y axis points up
+    auto m = Affine::rotation(-footprint.rotation);
     for (int i = 0; i < 8; ++i) {
         if (i != 0)
             s << ',';
-        double3 p = (center + size * double3(i & 1 ? 0.5 : -0.5, i & 2 ? 0.5 : -0.5, i & 4 ? 1.0 : 0.0)) / 2.54;
-        s << p;
+        double3 p = center + size * double3(i & 1 ? 0.5 : -0.5, i & 2 ? 0.5 : -0.5, i & 4 ? 1.0 : 0.0);
+        double2 xy = m(p.xy());
+        s << double3(xy.x, xy.y, p.z) / 2.54;
     }
 
 s << R"vrml(]}
@@ -1153,30 +2462,749 @@ s << R"vrml(]}
 }
 )vrml";
 
+    FileWriter::write(path / (name + ".wrl"), std::move(s).str());
+}
+
+// import of existing .kicad_mod files into footprint json. Pads get rebuilt as pad arrays where possible, a candidate
+// array is accepted only if placing its pads reproduces the imported pads
+
+using OrderedJson = nlohmann::ordered_json;
+
+// tolerance for comparing imported and placed pads
+constexpr double importTolerance = 1e-4;
+
+// round to the KiCad resolution of 1nm so that the json contains short numbers
+double roundNm(double x) {
+    return std::nearbyint(x * 1e6) / 1e6 + 0.0;
+}
+
+double2 roundNm(double2 v) {
+    return {roundNm(v.x), roundNm(v.y)};
+}
+
+bool near(double2 a, double2 b) {
+    return length(a - b) <= importTolerance;
+}
+
+// remove the escapes of a quoted KiCad string
+std::string unescape(std::string_view str) {
+    std::string result;
+    result.reserve(str.size());
+    for (size_t i = 0; i < str.size(); ++i) {
+        if (str[i] == '\\' && i + 1 < str.size())
+            ++i;
+        result += str[i];
+    }
+    return result;
+}
+
+// read a pad of a .kicad_mod file. The offset of an SMD pad is moved into its position
+void readKicadPad(const SExpr &e, int node, PlacedPad &pad) {
+    pad.name = unescape(e.get(node, 1));
+    auto type = e.get(node, 2);
+    auto shape = e.get(node, 3);
+
+    int at = e.find(node, "at");
+    pad.position = {e.number(at, 1), e.number(at, 2)};
+    pad.angle = normalizeAngle(e.number(at, 3));
+
+    int size = e.find(node, "size");
+    pad.size = {e.number(size, 1), e.number(size, 2)};
+
+    if (shape == "circle" || shape == "oval") {
+        pad.shape = CIRCLE;
+    } else if (shape == "roundrect") {
+        int ratio = e.find(node, "roundrect_rratio");
+        pad.shape = ratio >= 0 ? e.number(ratio, 1) : ROUNDRECT;
+    } else {
+        // rect, trapezoid and custom
+        pad.shape = RECT;
+    }
+
+    int drill = e.find(node, "drill");
+    if (drill >= 0) {
+        if (e.get(drill, 1) == "oval") {
+            pad.drillSize = {e.number(drill, 2), e.number(drill, 3)};
+        } else {
+            double d = e.number(drill, 1);
+            pad.drillSize = {d, d};
+        }
+        int offset = e.find(drill, "offset");
+        pad.padOffset = {e.number(offset, 1), e.number(offset, 2)};
+    }
+
+    // a non-plated hole has no pad
+    if (type == "np_thru_hole")
+        pad.size = {};
+
+    pad.clearance = e.number(e.find(node, "clearance"), 1);
+    pad.maskMargin = e.number(e.find(node, "solder_mask_margin"), 1);
+
+    // back side if only on B.Cu
+    pad.back = false;
+    int layers = e.find(node, "layers");
+    if (layers >= 0) {
+        bool front = false;
+        for (int layer = e.next(e.first(layers)); layer >= 0; layer = e.next(layer)) {
+            auto name = e.value(layer);
+            front |= name == "F.Cu" || name == "*.Cu";
+            pad.back |= name == "B.Cu";
+        }
+        pad.back &= !front;
+    }
+
+    if (!pad.drillSize.positive()) {
+        pad.position += Affine::rotation(pad.angle).linear(pad.padOffset);
+        pad.padOffset = {};
+    }
+}
+
+// check if two pads are of the same kind, i.e. can be in the same pad array (sizes may be swapped)
+bool samePadKind(const PlacedPad &a, const PlacedPad &b) {
+    auto sorted = [](double2 v) {return double2(std::min(v.x, v.y), std::max(v.x, v.y));};
+    return near(sorted(a.size), sorted(b.size)) && near(sorted(a.drillSize), sorted(b.drillSize))
+        && a.shape == b.shape && a.clearance == b.clearance && a.maskMargin == b.maskMargin && a.back == b.back;
+}
+
+// compare a placed pad with an imported pad, pads with angles that differ by 90 degrees have swapped sizes
+bool samePad(const PlacedPad &placed, const PlacedPad &imported) {
+    if (placed.name != imported.name || !near(placed.position, imported.position))
+        return false;
+    double angle = normalizeAngle(imported.angle - placed.angle);
+    long quarter = std::lround(angle / 90.0);
+    if (std::abs(angle - quarter * 90.0) > 1e-6)
+        return false;
+    bool swapped = quarter & 1;
+    return near(placed.size, swapped ? swap(imported.size) : imported.size)
+        && near(placed.drillSize, swapped ? swap(imported.drillSize) : imported.drillSize)
+        && near(placed.padOffset, Affine::rotation(quarter * 90.0).linear(imported.padOffset))
+        && placed.shape == imported.shape && placed.clearance == imported.clearance
+        && placed.maskMargin == imported.maskMargin && placed.back == imported.back;
+}
+
+// initialize a pad array from its first pad. The direction of the first row determines the rotation of the array
+bool initPadArray(const PlacedPad &first, double2 direction, Footprint::Pad &pad) {
+    double pitch = length(direction);
+    if (pitch <= importTolerance)
+        return false;
+    double rotation = std::atan2(-direction.y, direction.x) * 180.0 / std::numbers::pi;
+    double snapped = std::round(rotation / 90.0) * 90.0;
+    rotation = normalizeAngle(std::abs(rotation - snapped) < 1e-6 ? snapped : roundNm(rotation));
+
+    // angle of the first pad relative to the array
+    double angle = normalizeAngle(first.angle - rotation);
+    long quarter = std::lround(angle / 90.0);
+    if (std::abs(angle - quarter * 90.0) > 1e-6)
+        return false;
+    bool swapped = quarter & 1;
+
+    pad.size = roundNm(swapped ? swap(first.size) : first.size);
+    pad.shape = first.shape;
+    pad.drillSize = roundNm(swapped ? swap(first.drillSize) : first.drillSize);
+    pad.offset = roundNm(Affine::rotation(quarter * 90.0).linear(first.padOffset));
+    pad.clearance = first.clearance;
+    pad.maskMargin = first.maskMargin;
+    pad.back = first.back;
+    pad.pitch = roundNm(pitch);
+    pad.rotation = rotation;
+    return true;
+}
+
+// check if a pad array places exactly the given pads
+bool placesPads(const Footprint::Pad &pad, const std::vector<const PlacedPad *> &imported) {
+    Footprint footprint;
+    std::vector<PlacedPad> placed;
+    switch (pad.type) {
+    case Footprint::Pad::Type::SINGLE:
+        writeSingle(placed, footprint, pad);
+        break;
+    case Footprint::Pad::Type::DUAL:
+        writeDual(placed, footprint, pad);
+        break;
+    case Footprint::Pad::Type::QUAD:
+        writeQuad(placed, footprint.position, pad);
+        break;
+    case Footprint::Pad::Type::GRID:
+        return false;
+    }
+    if (pad.rotation != 0)
+        rotatePads(placed.data(), placed.data() + placed.size(), pad.position, pad.rotation);
+    if (placed.size() != imported.size())
+        return false;
+
+    std::unordered_map<std::string_view, const PlacedPad *> byName;
+    for (auto p : imported)
+        byName.emplace(p->name, p);
+    for (auto &p : placed) {
+        auto it = byName.find(p.name);
+        if (it == byName.end() || !samePad(p, *it->second))
+            return false;
+    }
+    return true;
+}
+
+// find a pad array (single row, dual rows or quad) for pads of the same kind that are sorted by number
+bool findPadArray(const std::vector<const PlacedPad *> &pads, int number, int increment, Footprint::Pad &pad) {
+    int count = pads.size();
+    auto p = [&](int i) {return pads[i]->position;};
+    pad.count = count;
+    pad.number = number;
+    pad.increment = increment;
+
+    // single row
+    pad.type = Footprint::Pad::Type::SINGLE;
+    pad.position = roundNm((p(0) + p(count - 1)) * 0.5);
+    if (initPadArray(*pads[0], p(1) - p(0), pad) && placesPads(pad, pads))
+        return true;
+
+    // dual rows with circular numbering
+    pad.type = Footprint::Pad::Type::DUAL;
+    if (count % 2 == 0 && count >= 4) {
+        int n = count / 2;
+        pad.numbering = Footprint::Pad::Numbering::CIRCULAR;
+        pad.position = roundNm((p(0) + p(n)) * 0.5);
+        pad.distance = {roundNm(length(p(0) - p(count - 1))), 0};
+        if (initPadArray(*pads[0], p(1) - p(0), pad) && placesPads(pad, pads))
+            return true;
+
+        // numbered by columns (zigzag)
+        pad.numbering = Footprint::Pad::Numbering::COLUMNS;
+        pad.position = roundNm((p(0) + p(count - 1)) * 0.5);
+        pad.distance = {roundNm(length(p(0) - p(1))), 0};
+        if (initPadArray(*pads[0], p(2) - p(0), pad) && placesPads(pad, pads))
+            return true;
+        pad.numbering = Footprint::Pad::Numbering::CIRCULAR;
+    }
+
+    // quad
+    pad.type = Footprint::Pad::Type::QUAD;
+    if (count % 4 == 0 && count >= 8) {
+        int n = count / 4;
+        pad.position = roundNm((p(0) + p(2 * n)) * 0.5);
+        pad.distance = roundNm(double2(length(p(0) - p(3 * n - 1)), length(p(n) - p(4 * n - 1))));
+        if (initPadArray(*pads[0], p(1) - p(0), pad) && placesPads(pad, pads))
+            return true;
+    }
+    return false;
+}
+
+// make a single pad that is not part of an array
+Footprint::Pad makeSinglePad(const PlacedPad &placed) {
+    Footprint::Pad pad;
+    pad.position = roundNm(placed.position);
+    pad.size = roundNm(placed.size);
+    pad.shape = placed.shape;
+    pad.drillSize = roundNm(placed.drillSize);
+    pad.offset = roundNm(placed.padOffset);
+    pad.clearance = placed.clearance;
+    pad.maskMargin = placed.maskMargin;
+    pad.back = placed.back;
+    pad.rotation = placed.angle;
+
+    // number or name
+    int number;
+    auto &name = placed.name;
+    auto result = std::from_chars(name.data(), name.data() + name.size(), number);
+    if (result.ec == std::errc() && result.ptr == name.data() + name.size() && std::to_string(number) == name)
+        pad.number = number;
+    else if (pad.size.positive())
+        pad.names.push_back(name);
+    return pad;
+}
+
+// number for the json output, integral values are written without fraction
+OrderedJson toJson(double x) {
+    if (x == std::trunc(x) && std::abs(x) < 1e9)
+        return int64_t(x);
+    return x;
+}
+
+OrderedJson toJson(double2 v) {
+    return OrderedJson::array({toJson(v.x), toJson(v.y)});
+}
+
+// convert a pad array to json, only fields that differ from the defaults are written
+OrderedJson toJson(const Footprint::Pad &pad) {
+    OrderedJson j = OrderedJson::object();
+    if (pad.type == Footprint::Pad::Type::DUAL)
+        j["type"] = "dual";
+    else if (pad.type == Footprint::Pad::Type::QUAD)
+        j["type"] = "quad";
+    if (pad.type == Footprint::Pad::Type::DUAL && pad.numbering == Footprint::Pad::Numbering::COLUMNS)
+        j["numbering"] = "columns";
+    if (pad.count != 1) {
+        j["count"] = pad.count;
+        j["pitch"] = toJson(pad.pitch);
+    }
+    if (pad.type == Footprint::Pad::Type::DUAL)
+        j["distance"] = toJson(pad.distance.x);
+    else if (pad.type == Footprint::Pad::Type::QUAD)
+        j["distance"] = toJson(pad.distance);
+    if (!pad.position.zero())
+        j["position"] = toJson(pad.position);
+    if (pad.rotation != 0)
+        j["rotation"] = toJson(pad.rotation);
+    if (pad.size.positive())
+        j["size"] = toJson(pad.size);
+    if (pad.shape != ROUNDRECT)
+        j["shape"] = toJson(pad.shape);
+    if (pad.drillSize.positive())
+        j["drillSize"] = toJson(pad.drillSize);
+    if (!pad.offset.zero())
+        j["offset"] = toJson(pad.offset);
+    if (pad.clearance > 0)
+        j["clearance"] = toJson(pad.clearance);
+    if (pad.maskMargin != 0)
+        j["maskMargin"] = toJson(pad.maskMargin);
+    if (pad.back)
+        j["back"] = true;
+    if (pad.number != 1)
+        j["number"] = pad.number;
+    if (pad.increment != 1)
+        j["increment"] = pad.increment;
+    if (!pad.names.empty())
+        j["names"] = pad.names;
+    return j;
+}
+
+// rebuild the pads of a footprint as pad arrays
+OrderedJson importPads(const std::vector<PlacedPad> &pads) {
+    // group pads of the same kind
+    std::vector<std::vector<const PlacedPad *>> kinds;
+    for (auto &pad : pads) {
+        auto it = std::find_if(kinds.begin(), kinds.end(), [&](auto &kind) {return samePadKind(*kind.front(), pad);});
+        if (it != kinds.end())
+            it->push_back(&pad);
+        else
+            kinds.push_back({&pad});
+    }
+
+    OrderedJson result = OrderedJson::array();
+    for (auto &kind : kinds) {
+        // an array needs numbered pads with constant increment
+        std::vector<std::pair<int, const PlacedPad *>> numbered;
+        for (auto pad : kind) {
+            int number;
+            auto &name = pad->name;
+            auto r = std::from_chars(name.data(), name.data() + name.size(), number);
+            if (r.ec != std::errc() || r.ptr != name.data() + name.size() || std::to_string(number) != name)
+                break;
+            numbered.emplace_back(number, pad);
+        }
+        std::sort(numbered.begin(), numbered.end());
+        int count = numbered.size();
+        int increment = count >= 2 ? numbered[1].first - numbered[0].first : 0;
+        bool regular = count == int(kind.size()) && count >= 2 && increment > 0;
+        for (int i = 1; regular && i < count; ++i)
+            regular = numbered[i].first - numbered[i - 1].first == increment;
+
+        if (regular) {
+            std::vector<const PlacedPad *> sorted;
+            for (auto &[number, pad] : numbered)
+                sorted.push_back(pad);
+            Footprint::Pad pad;
+            if (findPadArray(sorted, numbered.front().first, increment, pad)) {
+                result.push_back(toJson(pad));
+                continue;
+            }
+        }
+
+        // single pads
+        for (auto pad : kind)
+            result.push_back(toJson(makeSinglePad(*pad)));
+    }
+    return result;
+}
+
+// imported footprint
+struct ImportedFootprint {
+    std::string name;
+    OrderedJson value;
+    std::string error;
+};
+
+// import a .kicad_mod file. The body size gets derived from the fabrication layer, the other graphics are not
+// imported as they get generated from the body and pads
+void importKicadFile(const fs::path &file, ImportedFootprint &imported) {
+    MappedFile mapped(file);
+    if (!mapped.isOpen())
+        throw std::runtime_error("could not open file");
+    SExpr e(mapped.view());
+    int root = e.root();
+    if (root < 0 || (e.name(root) != "footprint" && e.name(root) != "module"))
+        throw std::runtime_error("not a footprint");
+    imported.name = unescape(e.get(root, 1));
+
+    std::vector<PlacedPad> pads;
+    Box fab = {{1e9, 1e9}, {-1e9, -1e9}};
+    for (int node = e.first(root); node >= 0; node = e.next(node)) {
+        if (!e.isList(node))
+            continue;
+        auto name = e.name(node);
+        if (name == "pad") {
+            readKicadPad(e, node, pads.emplace_back());
+        } else if (e.get(e.find(node, "layer"), 1) == "F.Fab") {
+            // include the points of lines, rectangles and polygons on the fabrication layer
+            for (int child = e.first(node); child >= 0; child = e.next(child)) {
+                if (!e.isList(child))
+                    continue;
+                auto type = e.name(child);
+                if (name != "fp_poly" && (type == "start" || type == "end")) {
+                    double2 p = {e.number(child, 1), e.number(child, 2)};
+                    fab.include({p, p});
+                } else if (name == "fp_poly" && type == "pts") {
+                    for (int xy = e.find(child, "xy"); xy >= 0; xy = e.find(child, "xy", xy)) {
+                        double2 p = {e.number(xy, 1), e.number(xy, 2)};
+                        fab.include({p, p});
+                    }
+                }
+            }
+        }
+    }
+
+    auto &j = imported.value;
+    j = OrderedJson::object();
+    auto description = unescape(e.get(e.find(root, "descr"), 1));
+    if (!description.empty())
+        j["description"] = description;
+    if (!fab.empty() && (fab.max - fab.min).positive()) {
+        double2 size = roundNm(fab.max - fab.min);
+        double2 center = roundNm((fab.min + fab.max) * 0.5);
+        j["body"] = OrderedJson::array({toJson(size.x), toJson(size.y), 0});
+        if (!center.zero())
+            j["offset"] = OrderedJson::array({toJson(center.x), toJson(center.y), 0});
+    }
+    j["pads"] = importPads(pads);
+}
+
+// import .kicad_mod files and directories containing them into a json file. Footprints with the same pads inherit
+// them from a shared template. An existing json file is only overwritten if forced
+bool importFootprints(const std::vector<fs::path> &inputs, const fs::path &output, bool force) {
+    // don't replace a maintained footprint file by accident
+    std::error_code ec;
+    if (!force && fs::exists(output, ec)) {
+        std::cerr << "error: " << output.string() << " exists, use --force to overwrite it" << std::endl;
+        return false;
+    }
+
+    std::vector<fs::path> files;
+    for (auto &input : inputs) {
+        if (fs::is_directory(input, ec)) {
+            for (auto &entry : fs::recursive_directory_iterator(input, ec)) {
+                if (entry.is_regular_file() && entry.path().extension() == ".kicad_mod")
+                    files.push_back(entry.path());
+            }
+        } else {
+            files.push_back(input);
+        }
+    }
+    std::sort(files.begin(), files.end());
+
+    std::vector<ImportedFootprint> footprints(files.size());
+    parallelFor(files.size(), [&](int i) {
+        try {
+            importKicadFile(files[i], footprints[i]);
+        } catch (std::exception &e) {
+            footprints[i].error = e.what();
+        }
+    }, 4);
+
+    // report errors, the first footprint of a name wins
+    std::set<std::string> names;
+    std::vector<ImportedFootprint *> imported;
+    for (int i = 0; i < int(files.size()); ++i) {
+        auto &footprint = footprints[i];
+        if (footprint.error.empty() && !names.insert(footprint.name).second)
+            footprint.error = "duplicate footprint " + footprint.name;
+        if (!footprint.error.empty()) {
+            std::cerr << files[i].string() << ": " << footprint.error << std::endl;
+            continue;
+        }
+        imported.push_back(&footprint);
+    }
+    std::sort(imported.begin(), imported.end(), [](auto a, auto b) {return a->name < b->name;});
+
+    // group footprints with the same pads
+    std::map<std::string, std::vector<ImportedFootprint *>> groups;
+    for (auto footprint : imported)
+        groups[footprint->value["pads"].dump()].push_back(footprint);
+    std::map<const ImportedFootprint *, std::pair<std::string, OrderedJson>> templates;
+    for (auto &[pads, group] : groups) {
+        if (group.size() < 2)
+            continue;
+        auto first = group.front();
+        std::string name = first->name + "_Pads";
+        while (names.contains(name))
+            name += '_';
+        names.insert(name);
+        OrderedJson t = {{"template", true}, {"pads", first->value["pads"]}};
+        templates[first] = {name, std::move(t)};
+        for (auto footprint : group) {
+            // the pads get inherited, an empty object per pad array keeps them
+            OrderedJson j = {{"inherit", name}};
+            for (auto &[key, value] : footprint->value.items())
+                j[key] = key == "pads" ? OrderedJson(value.size(), OrderedJson::object()) : value;
+            footprint->value = std::move(j);
+        }
+    }
+
+    // write one footprint per line, a template comes before the first footprint that uses it
+    std::ofstream s(output.string());
+    if (!s.is_open()) {
+        std::cerr << "error: could not open file " << output.string() << std::endl;
+        return false;
+    }
+    s << "{";
+    bool first = true;
+    auto write = [&](const std::string &name, const OrderedJson &value) {
+        s << (first ? "\n  " : ",\n  ") << OrderedJson(name).dump() << ": " << value.dump();
+        first = false;
+    };
+    for (auto footprint : imported) {
+        auto t = templates.find(footprint);
+        if (t != templates.end())
+            write(t->second.first, t->second.second);
+        write(footprint->name, footprint->value);
+        std::cout << footprint->name << std::endl;
+    }
+    s << "\n}\n";
+
+    // a full disk etc. only shows up in the stream state, the import fails instead of leaving a truncated file
     s.close();
+    if (!s) {
+        std::cerr << "error: could not write " << output.string() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+#ifdef FUZZ
+
+// fuzz target: generates the footprints of a json input with all output formats and aborts if the time or the peak
+// memory exceed a budget that is linear in the size of the input and the number of pads and points. Runs under
+// libFuzzer (FUZZ_LIBFUZZER) or as a standalone driver for the files of a corpus
+
+// small limits keep the iterations fast, the corpus contains inputs just past them
+constexpr Limits fuzzLimits = {.pads = 1000, .points = 1000, .depth = 16};
+
+// budget: fixed part and part per input byte, pad and point
+constexpr double fuzzSeconds = 1.0;
+constexpr double fuzzSecondsPerItem = 0.002;
+constexpr int64_t fuzzBytes = 64 << 20;
+constexpr int64_t fuzzBytesPerItem = 64 << 10;
+
+void fuzzOne(const uint8_t *data, size_t size) {
+    static fs::path dir = fs::temp_directory_path() / "footprint-fuzz";
+    fs::create_directories(dir);
+    Output out;
+    out.get<Kicad8Emitter>().enabled = true;
+    out.get<Kicad8Emitter>().directory = "kicad8";
+    out.get<GeometryEmitter>().enabled = true;
+    out.get<SvgEmitter>().enabled = true;
+
+    allocResetPeak();
+    int64_t live = allocLive();
+    auto start = std::chrono::steady_clock::now();
+    int64_t items = size;
+    try {
+        json j = json::parse(data, data + size, nullptr, true, true);
+        readFootprints(j, [&](std::vector<ResolvedFootprint> &level) {
+            for (auto &resolved : level) {
+                if (resolved.footprint.template_)
+                    continue;
+                items += countPads(resolved.footprint) + countPoints(resolved.footprint);
+                try {
+                    // fixed file name so that names from the input can't point outside of the directory
+                    Output o = out;
+                    if (generateFootprint(o, dir, "footprint", resolved.footprint))
+                        generateVrml(dir, "footprint", resolved.footprint);
+                } catch (std::exception &e) {
+                    std::cerr << resolved.name << ": " << e.what() << std::endl;
+                }
+            }
+        }, fuzzLimits);
+    } catch (std::exception &e) {
+        std::cerr << "json: " << e.what() << std::endl;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    int64_t bytes = allocPeak() - live;
+
+    // flag superlinear growth
+    if (seconds > fuzzSeconds + items * fuzzSecondsPerItem || bytes > fuzzBytes + items * fuzzBytesPerItem) {
+        std::cerr << "fuzz: " << seconds << " s and " << bytes << " bytes exceed the budget for " << items
+            << " items (input bytes, pads and points)" << std::endl;
+        std::abort();
+    }
+}
+
+#ifdef FUZZ_LIBFUZZER
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    fuzzOne(data, size);
+    return 0;
+}
+
+#else
+
+// run the fuzz target on files and directories of files, e.g. the regression corpus
+int main(int argc, const char **argv) {
+    std::vector<fs::path> files;
+    for (int i = 1; i < argc; ++i) {
+        fs::path path = argv[i];
+        if (fs::is_directory(path)) {
+            for (auto &entry : fs::directory_iterator(path)) {
+                if (entry.is_regular_file())
+                    files.push_back(entry.path());
+            }
+        } else {
+            files.push_back(path);
+        }
+    }
+    std::sort(files.begin(), files.end());
+    for (auto &file : files) {
+        std::ifstream f(file.string(), std::ios::binary);
+        std::string data((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+        std::cerr << "fuzz: " << file.string() << std::endl;
+        fuzzOne(reinterpret_cast<const uint8_t *>(data.data()), data.size());
+    }
+    return 0;
 }
 
+#endif
+
+#else
+
 int main(int argc, const char **argv) {
-    if (argc < 2)
+    fs::path path;
+    Selection selection;
+    Limits limits;
+    std::vector<fs::path> imports;
+    bool force = false;
+    Output out;
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (arg == "--format" && i + 1 < argc) {
+            // comma separated list of output formats
+            std::string_view formats = argv[++i];
+            out.get<KicadEmitter>().enabled = false;
+            while (!formats.empty()) {
+                auto format = formats.substr(0, formats.find(','));
+                formats.remove_prefix(std::min(format.size() + 1, formats.size()));
+                if (format == "legacy") {
+                    out.get<KicadEmitter>().enabled = true;
+                } else if (format == "kicad8") {
+                    out.get<Kicad8Emitter>().enabled = true;
+                } else if (format == "geometry") {
+                    out.get<GeometryEmitter>().enabled = true;
+                } else if (format == "svg") {
+                    out.get<SvgEmitter>().enabled = true;
+                } else {
+                    std::cerr << "error: unknown format " << format << std::endl;
+                    return 1;
+                }
+            }
+
+            // write KiCad 8 format into subdirectory if legacy format is written too
+            if (out.get<KicadEmitter>().enabled)
+                out.get<Kicad8Emitter>().directory = "kicad8";
+        } else if (arg == "--svg") {
+            // svg previews and html index in addition to the other formats
+            out.get<SvgEmitter>().enabled = true;
+        } else if (arg == "--only" && i + 1 < argc) {
+            // generate only footprints matching the glob pattern
+            selection.patterns.push_back(argv[++i]);
+        } else if (arg == "--only-from" && i + 1 < argc) {
+            // read glob patterns from file
+            fs::path file = argv[++i];
+            if (!selection.read(file)) {
+                std::cerr << "error: could not open file " << file.string() << std::endl;
+                return 1;
+            }
+        } else if ((arg == "--max-pads" || arg == "--max-points" || arg == "--max-depth") && i + 1 < argc) {
+            // resource limits
+            int &limit = arg == "--max-pads" ? limits.pads : (arg == "--max-points" ? limits.points : limits.depth);
+            std::string_view value = argv[++i];
+            auto result = std::from_chars(value.data(), value.data() + value.size(), limit);
+            if (result.ec != std::errc() || result.ptr != value.data() + value.size() || limit < 0) {
+                std::cerr << "error: invalid limit " << value << std::endl;
+                return 1;
+            }
+        } else if (arg == "--import" && i + 1 < argc) {
+            // import .kicad_mod files into the json file instead of generating
+            imports.push_back(argv[++i]);
+        } else if (arg == "--force") {
+            // allow --import to overwrite an existing json file
+            force = true;
+        } else {
+            path = arg;
+        }
+    }
+    if (path.empty())
         return 1;
-    fs::path path = argv[1];
+    if (!imports.empty())
+        return importFootprints(imports, path, force) ? 0 : 1;
     //fs::path path = "footprints.json";
 
+    // pipeline: footprints of each inheritance level go into the queue as soon as they are resolved, generator
+    // threads emit them while further levels are read and the file writer writes the output in the background
+    FileWriter writer;
+    BoundedQueue<ResolvedFootprint> queue(64);
+    std::mutex mutex;
+    std::vector<std::string> names;
+    auto dir = path.parent_path();
+    std::vector<std::thread> generators;
+    int generatorCount = std::max(int(std::thread::hardware_concurrency()), 1);
+    for (int i = 0; i < generatorCount; ++i) {
+        generators.emplace_back([&] {
+            ResolvedFootprint job;
+            while (queue.pop(job)) {
+                BusyScope busy;
+                auto &name = job.name;
+                ALLOC_FOOTPRINT(name.c_str());
+
+                // each generator uses its own copy of the emitters
+                try {
+                    Output o = out;
+                    if (generateFootprint(o, dir, name, job.footprint))
+                        generateVrml(dir, name, job.footprint);
+                } catch (std::exception &e) {
+                    // generating the footprint failed, continue with the next one
+                    std::cerr << name << ": " << e.what() << std::endl;
+                    continue;
+                }
+
+                std::lock_guard lock(mutex);
+                if (job.footprint.backVariant)
+                    names.push_back(name + backSuffix);
+                names.push_back(std::move(name));
+            }
+        });
+    }
+
     // read footprints
-    std::map<std::string, Footprint> footprints;
-    readJson(path, footprints);
-
-    // generate footprints
-    for (const auto &[name, footprint] : footprints) {
-        // check if footprint is a template
-        if (footprint.template_)
-            continue;;
+    readJson(path, [&](std::vector<ResolvedFootprint> &level) {
+        for (auto &resolved : level) {
+            // check if footprint is a template or not selected
+            if (resolved.footprint.template_ || !selection.matches(resolved.name))
+                continue;
+            queue.push(std::move(resolved));
+        }
+    }, selection, limits);
+    queue.close();
+    for (auto &generator : generators)
+        generator.join();
+
+    // list generated footprints in order of their names
+    std::sort(names.begin(), names.end());
+    for (auto &name : names)
         std::cout << name << std::endl;
 
-        auto dir = path.parent_path();
-        if (generateFootprint(dir, name, footprint))
-            generateVrml(dir, name, footprint);
-    }
+    // contact sheet of svg previews
+    if (out.get<SvgEmitter>().enabled)
+        SvgEmitter::writeIndex(dir, names);
 
+    ALLOC_REPORT(std::cerr);
     return 0;
 }
+
+#endif
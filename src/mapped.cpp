@@ -0,0 +1,73 @@
+#include "mapped.hpp"
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::filesystem::path &path) {
+	HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return;
+	LARGE_INTEGER size;
+	if (GetFileSizeEx(file, &size)) {
+		this->size = size_t(size.QuadPart);
+
+		// an empty file can't be mapped
+		this->open = this->size == 0;
+		if (this->size > 0) {
+			HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (mapping != nullptr) {
+				this->data = static_cast<const char *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+				this->open = this->data != nullptr;
+				CloseHandle(mapping);
+			}
+		}
+	}
+	CloseHandle(file);
+}
+
+MappedFile::~MappedFile() {
+	if (this->data != nullptr)
+		UnmapViewOfFile(this->data);
+}
+
+#else
+
+MappedFile::MappedFile(const std::filesystem::path &path) {
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd == -1)
+		return;
+	struct stat s;
+	if (fstat(fd, &s) == 0) {
+		this->size = size_t(s.st_size);
+
+		// an empty file can't be mapped
+		this->open = this->size == 0;
+		if (this->size > 0) {
+			void *data = mmap(nullptr, this->size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (data != MAP_FAILED) {
+				madvise(data, this->size, MADV_SEQUENTIAL);
+				this->data = static_cast<const char *>(data);
+				this->open = true;
+			}
+		}
+	}
+	close(fd);
+}
+
+MappedFile::~MappedFile() {
+	if (this->data != nullptr)
+		munmap(const_cast<char *>(this->data), this->size);
+}
+
+#endif
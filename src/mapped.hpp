@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <string_view>
+
+
+// read-only memory mapped file
+class MappedFile {
+public:
+	// map a file, check with isOpen()
+	explicit MappedFile(const std::filesystem::path &path);
+
+	~MappedFile();
+
+	MappedFile(const MappedFile &) = delete;
+	MappedFile &operator =(const MappedFile &) = delete;
+
+	bool isOpen() const {return this->open;}
+
+	// contents of the file
+	std::string_view view() const {return {this->data, this->size};}
+
+private:
+	const char *data = nullptr;
+	size_t size = 0;
+	bool open = false;
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+
+// number of threads that are busy, parallelFor only starts threads for free cores so that nested calls (e.g. from the
+// generator threads or from a parallelFor) don't start more threads than there are cores
+inline std::atomic<int> busyThreads = 1;
+
+// counts the current thread as busy while in scope, used by threads that get work from a queue
+class BusyScope {
+public:
+	BusyScope() {busyThreads.fetch_add(1);}
+	~BusyScope() {busyThreads.fetch_sub(1);}
+};
+
+// reserve up to count threads on free cores, returns the number of reserved threads
+inline int reserveThreads(int count) {
+	int cores = std::max(int(std::thread::hardware_concurrency()), 1);
+	int busy = busyThreads.load();
+	int n;
+	do {
+		n = std::clamp(cores - busy, 0, count);
+		if (n == 0)
+			return 0;
+	} while (!busyThreads.compare_exchange_weak(busy, busy + n));
+	return n;
+}
+
+// call function for each index in [0, count) using the free cores. Small counts are processed on the calling thread
+template <typename F>
+void parallelFor(int count, F function, int minPerThread = 16) {
+	int threadCount = std::min(int(std::thread::hardware_concurrency()), count / std::max(minPerThread, 1));
+	int extra = threadCount > 1 ? reserveThreads(threadCount - 1) : 0;
+	if (extra == 0) {
+		for (int i = 0; i < count; ++i)
+			function(i);
+		return;
+	}
+
+	std::atomic<int> next = 0;
+	auto worker = [&]() {
+		int i;
+		while ((i = next.fetch_add(1)) < count)
+			function(i);
+	};
+
+	std::vector<std::thread> threads;
+	for (int t = 0; t < extra; ++t)
+		threads.emplace_back(worker);
+	worker();
+	for (auto &thread : threads)
+		thread.join();
+	busyThreads.fetch_sub(extra);
+}
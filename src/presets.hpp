@@ -0,0 +1,120 @@
+#pragma once
+
+#include "ipc7351.hpp"
+#include <string_view>
+
+
+// built-in templates of common JEDEC/IPC package families. Json footprints inherit from them like from a template
+// defined in the json file, a template in the json file with the same name takes precedence
+
+// arrangement of the pads of a preset
+enum class PresetPads {
+	// single row
+	SINGLE,
+
+	// dual rows (circular numbering)
+	DUAL,
+
+	// dual rows numbered by columns (zigzag, e.g. pin headers)
+	DUAL_ZIGZAG,
+
+	// quad rows
+	QUAD,
+};
+
+// package family. Pads either get calculated from the IPC-7351 lead dimensions (min, max) or have a fixed size
+struct Preset {
+	std::string_view name;
+	std::string_view description;
+	PresetPads pads;
+	int count;
+	double pitch;
+
+	// body size for silkscreen, courtyard and 3D model
+	double body[3];
+
+	// IPC-7351 lead dimensions
+	LeadType lead = LeadType::NONE;
+	double span[2] = {};
+	double terminal[2] = {};
+	double width[2] = {};
+
+	// fixed pads (through hole) if lead is NONE, shape as in emitter.hpp (0.5 is round)
+	double size = 0;
+	double drill = 0;
+	double distance = 0;
+	double shape = 0;
+
+	// comma separated pin names, an empty name leaves out a pin (e.g. SOT-23)
+	std::string_view names = {};
+};
+
+constexpr Preset presets[] = {
+	// SOIC (JEDEC MS-012)
+	{.name = "SOIC-8", .description = "SOIC, 8 pins, 1.27mm pitch, 3.9mm body", .pads = PresetPads::DUAL, .count = 8,
+		.pitch = 1.27, .body = {4.9, 3.9, 1.75},
+		.lead = LeadType::GULLWING, .span = {5.8, 6.2}, .terminal = {0.4, 1.27}, .width = {0.31, 0.51}},
+	{.name = "SOIC-14", .description = "SOIC, 14 pins, 1.27mm pitch, 3.9mm body", .pads = PresetPads::DUAL, .count = 14,
+		.pitch = 1.27, .body = {8.65, 3.9, 1.75},
+		.lead = LeadType::GULLWING, .span = {5.8, 6.2}, .terminal = {0.4, 1.27}, .width = {0.31, 0.51}},
+	{.name = "SOIC-16", .description = "SOIC, 16 pins, 1.27mm pitch, 3.9mm body", .pads = PresetPads::DUAL, .count = 16,
+		.pitch = 1.27, .body = {9.9, 3.9, 1.75},
+		.lead = LeadType::GULLWING, .span = {5.8, 6.2}, .terminal = {0.4, 1.27}, .width = {0.31, 0.51}},
+
+	// SOT-23 (JEDEC TO-236, MO-178)
+	{.name = "SOT-23", .description = "SOT-23, 3 pins, 0.95mm pitch", .pads = PresetPads::DUAL, .count = 6,
+		.pitch = 0.95, .body = {2.9, 1.3, 1.1},
+		.lead = LeadType::GULLWING, .span = {2.1, 2.64}, .terminal = {0.3, 0.6}, .width = {0.3, 0.5},
+		.names = "1,,2,,3,"},
+	{.name = "SOT-23-5", .description = "SOT-23, 5 pins, 0.95mm pitch", .pads = PresetPads::DUAL, .count = 6,
+		.pitch = 0.95, .body = {2.9, 1.6, 1.45},
+		.lead = LeadType::GULLWING, .span = {2.6, 3.0}, .terminal = {0.3, 0.6}, .width = {0.3, 0.5},
+		.names = "1,2,3,4,,5"},
+	{.name = "SOT-23-6", .description = "SOT-23, 6 pins, 0.95mm pitch", .pads = PresetPads::DUAL, .count = 6,
+		.pitch = 0.95, .body = {2.9, 1.6, 1.45},
+		.lead = LeadType::GULLWING, .span = {2.6, 3.0}, .terminal = {0.3, 0.6}, .width = {0.3, 0.5}},
+
+	// QFN without exposed pad (JEDEC MO-220)
+	{.name = "QFN-16-3x3", .description = "QFN, 16 pins, 0.5mm pitch, 3x3mm body", .pads = PresetPads::QUAD,
+		.count = 16, .pitch = 0.5, .body = {3, 3, 0.9},
+		.lead = LeadType::NO_LEAD, .span = {2.9, 3.1}, .terminal = {0.3, 0.5}, .width = {0.18, 0.3}},
+	{.name = "QFN-20-4x4", .description = "QFN, 20 pins, 0.5mm pitch, 4x4mm body", .pads = PresetPads::QUAD,
+		.count = 20, .pitch = 0.5, .body = {4, 4, 0.9},
+		.lead = LeadType::NO_LEAD, .span = {3.9, 4.1}, .terminal = {0.3, 0.5}, .width = {0.18, 0.3}},
+	{.name = "QFN-32-5x5", .description = "QFN, 32 pins, 0.5mm pitch, 5x5mm body", .pads = PresetPads::QUAD,
+		.count = 32, .pitch = 0.5, .body = {5, 5, 0.9},
+		.lead = LeadType::NO_LEAD, .span = {4.9, 5.1}, .terminal = {0.3, 0.5}, .width = {0.18, 0.3}},
+
+	// TQFP (JEDEC MS-026)
+	{.name = "TQFP-32-7x7", .description = "TQFP, 32 pins, 0.8mm pitch, 7x7mm body", .pads = PresetPads::QUAD,
+		.count = 32, .pitch = 0.8, .body = {7, 7, 1.2},
+		.lead = LeadType::GULLWING, .span = {8.8, 9.2}, .terminal = {0.45, 0.75}, .width = {0.3, 0.45}},
+	{.name = "TQFP-44-10x10", .description = "TQFP, 44 pins, 0.8mm pitch, 10x10mm body", .pads = PresetPads::QUAD,
+		.count = 44, .pitch = 0.8, .body = {10, 10, 1.2},
+		.lead = LeadType::GULLWING, .span = {11.8, 12.2}, .terminal = {0.45, 0.75}, .width = {0.3, 0.45}},
+	{.name = "TQFP-48-7x7", .description = "TQFP, 48 pins, 0.5mm pitch, 7x7mm body", .pads = PresetPads::QUAD,
+		.count = 48, .pitch = 0.5, .body = {7, 7, 1.2},
+		.lead = LeadType::GULLWING, .span = {8.8, 9.2}, .terminal = {0.45, 0.75}, .width = {0.17, 0.27}},
+	{.name = "TQFP-64-10x10", .description = "TQFP, 64 pins, 0.5mm pitch, 10x10mm body", .pads = PresetPads::QUAD,
+		.count = 64, .pitch = 0.5, .body = {10, 10, 1.2},
+		.lead = LeadType::GULLWING, .span = {11.8, 12.2}, .terminal = {0.45, 0.75}, .width = {0.17, 0.27}},
+	{.name = "TQFP-100-14x14", .description = "TQFP, 100 pins, 0.5mm pitch, 14x14mm body", .pads = PresetPads::QUAD,
+		.count = 100, .pitch = 0.5, .body = {14, 14, 1.2},
+		.lead = LeadType::GULLWING, .span = {15.8, 16.2}, .terminal = {0.45, 0.75}, .width = {0.17, 0.27}},
+
+	// pin headers, a variant sets the pin count and the body length
+	{.name = "PinHeader-1xN-2.54", .description = "pin header, single row, 2.54mm pitch", .pads = PresetPads::SINGLE,
+		.count = 1, .pitch = 2.54, .body = {2.54, 2.54, 8.5}, .size = 1.7, .drill = 1.0, .shape = 0.5},
+	{.name = "PinHeader-2xN-2.54", .description = "pin header, double row, 2.54mm pitch",
+		.pads = PresetPads::DUAL_ZIGZAG, .count = 2, .pitch = 2.54, .body = {2.54, 5.08, 8.5}, .size = 1.7,
+		.drill = 1.0, .distance = 2.54, .shape = 0.5},
+};
+
+// find a preset by name, nullptr if not found
+constexpr const Preset *findPreset(std::string_view name) {
+	for (auto &preset : presets) {
+		if (preset.name == name)
+			return &preset;
+	}
+	return nullptr;
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <memory>
+
+
+// bounded multi producer multi consumer queue. Push and pop are lock-free (ring buffer with a sequence number per
+// cell), waiting on a full or empty queue uses atomic wait
+template <typename T>
+class BoundedQueue {
+public:
+	// capacity gets rounded up to a power of two
+	explicit BoundedQueue(size_t capacity) : mask(std::bit_ceil(std::max(capacity, size_t(2))) - 1) {
+		this->cells = std::make_unique<Cell[]>(this->mask + 1);
+		for (size_t i = 0; i <= this->mask; ++i)
+			this->cells[i].sequence.store(i, std::memory_order_relaxed);
+	}
+
+	// push a value, waits while the queue is full
+	void push(T value) {
+		while (true) {
+			uint32_t version = this->version.load(std::memory_order_acquire);
+			if (tryPush(value)) {
+				signal();
+				return;
+			}
+			this->version.wait(version, std::memory_order_acquire);
+		}
+	}
+
+	// pop a value, waits while the queue is empty. Returns false when the queue is empty and closed
+	bool pop(T &value) {
+		while (true) {
+			uint32_t version = this->version.load(std::memory_order_acquire);
+			if (tryPop(value)) {
+				signal();
+				return true;
+			}
+			if (this->closed.load(std::memory_order_acquire))
+				return tryPop(value);
+			this->version.wait(version, std::memory_order_acquire);
+		}
+	}
+
+	// close the queue after the last push, wakes up the waiting consumers
+	void close() {
+		this->closed.store(true, std::memory_order_release);
+		signal();
+	}
+
+private:
+	struct Cell {
+		std::atomic<size_t> sequence;
+		T value;
+	};
+
+	bool tryPush(T &value) {
+		size_t pos = this->pushPos.load(std::memory_order_relaxed);
+		while (true) {
+			auto &cell = this->cells[pos & this->mask];
+			size_t sequence = cell.sequence.load(std::memory_order_acquire);
+			intptr_t diff = intptr_t(sequence) - intptr_t(pos);
+			if (diff == 0) {
+				if (this->pushPos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+					cell.value = std::move(value);
+					cell.sequence.store(pos + 1, std::memory_order_release);
+					return true;
+				}
+			} else if (diff < 0) {
+				// full
+				return false;
+			} else {
+				pos = this->pushPos.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	bool tryPop(T &value) {
+		size_t pos = this->popPos.load(std::memory_order_relaxed);
+		while (true) {
+			auto &cell = this->cells[pos & this->mask];
+			size_t sequence = cell.sequence.load(std::memory_order_acquire);
+			intptr_t diff = intptr_t(sequence) - intptr_t(pos + 1);
+			if (diff == 0) {
+				if (this->popPos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+					value = std::move(cell.value);
+					cell.sequence.store(pos + this->mask + 1, std::memory_order_release);
+					return true;
+				}
+			} else if (diff < 0) {
+				// empty
+				return false;
+			} else {
+				pos = this->popPos.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	// wake up threads that wait for a change
+	void signal() {
+		this->version.fetch_add(1, std::memory_order_release);
+		this->version.notify_all();
+	}
+
+	size_t mask;
+	std::unique_ptr<Cell[]> cells;
+	alignas(64) std::atomic<size_t> pushPos = 0;
+	alignas(64) std::atomic<size_t> popPos = 0;
+	alignas(64) std::atomic<uint32_t> version = 0;
+	std::atomic<bool> closed = false;
+};
@@ -0,0 +1,108 @@
+#include "sexpr.hpp"
+#include <charconv>
+#include <stdexcept>
+#include <string>
+
+
+namespace {
+
+bool isSpace(char ch) {
+	return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r';
+}
+
+} // namespace
+
+
+SExpr::SExpr(std::string_view text) {
+	// a KiCad file has roughly one node per 8 bytes
+	this->nodes.reserve(text.size() / 8);
+
+	// open lists and their last element
+	struct Open {
+		int list;
+		int last;
+	};
+	std::vector<Open> stack;
+
+	// link a new node into the current list
+	auto add = [&](std::string_view value, int child) {
+		int index = int(this->nodes.size());
+		this->nodes.push_back({value, child});
+		if (!stack.empty()) {
+			auto &open = stack.back();
+			if (open.last == -1)
+				this->nodes[open.list].child = index;
+			else
+				this->nodes[open.last].next = index;
+			open.last = index;
+		} else if (index > 0) {
+			throw std::runtime_error("unexpected data after end of expression");
+		}
+		return index;
+	};
+
+	size_t i = 0;
+	size_t size = text.size();
+	while (i < size) {
+		char ch = text[i];
+		if (isSpace(ch)) {
+			++i;
+		} else if (ch == '(') {
+			int list = add({}, -1);
+			stack.push_back({list, -1});
+			++i;
+		} else if (ch == ')') {
+			if (stack.empty())
+				throw std::runtime_error("unbalanced ')'");
+			stack.pop_back();
+			++i;
+		} else if (ch == '"') {
+			// quoted string, escapes are kept
+			size_t start = ++i;
+			while (i < size && text[i] != '"')
+				i += text[i] == '\\' ? 2 : 1;
+			if (i >= size)
+				throw std::runtime_error("unterminated string");
+			add(text.substr(start, i - start), NO_CHILD);
+			++i;
+		} else {
+			// symbol or number
+			size_t start = i;
+			while (i < size && !isSpace(text[i]) && text[i] != '(' && text[i] != ')')
+				++i;
+			add(text.substr(start, i - start), NO_CHILD);
+		}
+	}
+	if (!stack.empty())
+		throw std::runtime_error("missing ')'");
+}
+
+std::string_view SExpr::name(int list) const {
+	int first = this->nodes[list].child;
+	return first >= 0 ? this->nodes[first].value : std::string_view();
+}
+
+int SExpr::find(int list, std::string_view name, int start) const {
+	for (int node = start == -1 ? first(list) : next(start); node >= 0; node = next(node)) {
+		if (isList(node) && this->name(node) == name)
+			return node;
+	}
+	return -1;
+}
+
+std::string_view SExpr::get(int list, int index) const {
+	if (list < 0)
+		return {};
+	int node = first(list);
+	for (; node >= 0 && index > 0; --index)
+		node = next(node);
+	return node >= 0 && !isList(node) ? value(node) : std::string_view();
+}
+
+double SExpr::number(int list, int index) const {
+	auto value = get(list, index);
+	double result = 0;
+	if (std::from_chars(value.data(), value.data() + value.size(), result).ec != std::errc())
+		return 0;
+	return result;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+
+
+// s-expression as used by KiCad files, e.g. (pad "1" smd rect (at 1 2) (size 1 0.5)). The nodes reference the text
+// without copying, therefore the text must outlive the expression. Nodes are identified by their index, -1 is none
+class SExpr {
+public:
+	// parse text, throws std::runtime_error on syntax errors
+	explicit SExpr(std::string_view text);
+
+	// first top level node
+	int root() const {return this->nodes.empty() ? -1 : 0;}
+
+	bool isList(int node) const {return this->nodes[node].child != NO_CHILD;}
+
+	// value of an atom, quoted strings without quotes
+	std::string_view value(int node) const {return this->nodes[node].value;}
+
+	// first element of a list, -1 if the list is empty or the node is an atom
+	int first(int node) const {
+		int child = this->nodes[node].child;
+		return child >= 0 ? child : -1;
+	}
+
+	// next sibling, -1 if node is the last element of its list
+	int next(int node) const {return this->nodes[node].next;}
+
+	// name of a list, i.e. the value of its first element
+	std::string_view name(int list) const;
+
+	// find child list with given name, starting after the node start, e.g. find(pad, "at")
+	int find(int list, std::string_view name, int start = -1) const;
+
+	// value of the index-th element of a list, empty if it does not exist or is a list. A list of -1 is allowed so that
+	// the result of find() can be passed directly
+	std::string_view get(int list, int index) const;
+
+	// number of the index-th element of a list, 0 if it does not exist or is not a number
+	double number(int list, int index) const;
+
+private:
+	// marks an atom
+	static constexpr int NO_CHILD = -2;
+
+	struct Node {
+		std::string_view value;
+		int child;
+		int next = -1;
+	};
+
+	std::vector<Node> nodes;
+};
@@ -0,0 +1,142 @@
+#pragma once
+
+#include "double2.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+
+// axis aligned box
+struct Box {
+	double2 min;
+	double2 max;
+
+	static Box centered(double2 center, double2 size) {
+		double2 h = {std::abs(size.x) * 0.5, std::abs(size.y) * 0.5};
+		return {center - h, center + h};
+	}
+
+	// box around a line segment of given width
+	static Box segment(double2 a, double2 b, double width) {
+		double w = width * 0.5;
+		return {{std::min(a.x, b.x) - w, std::min(a.y, b.y) - w}, {std::max(a.x, b.x) + w, std::max(a.y, b.y) + w}};
+	}
+
+	bool empty() const {return this->min.x > this->max.x || this->min.y > this->max.y;}
+
+	bool intersects(const Box &b) const {
+		return this->min.x < b.max.x && b.min.x < this->max.x && this->min.y < b.max.y && b.min.y < this->max.y;
+	}
+
+	void include(const Box &b) {
+		this->min = {std::min(this->min.x, b.min.x), std::min(this->min.y, b.min.y)};
+		this->max = {std::max(this->max.x, b.max.x), std::max(this->max.y, b.max.y)};
+	}
+
+	Box expanded(double d) const {
+		return {this->min - double2(d, d), this->max + double2(d, d)};
+	}
+};
+
+
+// spatial index of boxes on a uniform grid for collision queries
+class BoxIndex {
+public:
+	explicit BoxIndex(double cellSize = 1.0) : cellSize(cellSize) {}
+
+	void add(const Box &box) {
+		int index = int(this->boxes.size());
+		this->boxes.push_back(box);
+
+		int x1, y1, x2, y2;
+		cellRange(box, x1, y1, x2, y2);
+		if (int64_t(x2 - x1 + 1) * (y2 - y1 + 1) > MAX_CELLS) {
+			// box covers too many cells, always gets checked
+			this->large.push_back(index);
+			return;
+		}
+		for (int y = y1; y <= y2; ++y) {
+			for (int x = x1; x <= x2; ++x)
+				this->cells[key(x, y)].push_back(index);
+		}
+	}
+
+	// check if a box intersects any box in the index
+	bool intersects(const Box &box) const {
+		for (int index : this->large) {
+			if (this->boxes[index].intersects(box))
+				return true;
+		}
+
+		int x1, y1, x2, y2;
+		cellRange(box, x1, y1, x2, y2);
+		for (int y = y1; y <= y2; ++y) {
+			for (int x = x1; x <= x2; ++x) {
+				auto it = this->cells.find(key(x, y));
+				if (it == this->cells.end())
+					continue;
+				for (int index : it->second) {
+					if (this->boxes[index].intersects(box))
+						return true;
+				}
+			}
+		}
+		return false;
+	}
+
+	// get the indices of the boxes that intersect a box in the order they were added
+	void query(const Box &box, std::vector<int> &indices) const {
+		indices.clear();
+		int x1, y1, x2, y2;
+		cellRange(box, x1, y1, x2, y2);
+		if (int64_t(x2 - x1 + 1) * (y2 - y1 + 1) > MAX_CELLS) {
+			// box covers too many cells, check all boxes
+			for (int index = 0; index < int(this->boxes.size()); ++index) {
+				if (this->boxes[index].intersects(box))
+					indices.push_back(index);
+			}
+			return;
+		}
+
+		for (int index : this->large) {
+			if (this->boxes[index].intersects(box))
+				indices.push_back(index);
+		}
+		for (int y = y1; y <= y2; ++y) {
+			for (int x = x1; x <= x2; ++x) {
+				auto it = this->cells.find(key(x, y));
+				if (it == this->cells.end())
+					continue;
+				for (int index : it->second) {
+					if (this->boxes[index].intersects(box))
+						indices.push_back(index);
+				}
+			}
+		}
+
+		// a box that covers several cells is found once per cell
+		std::sort(indices.begin(), indices.end());
+		indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+	}
+
+private:
+	static constexpr int MAX_CELLS = 4096;
+
+	static uint64_t key(int x, int y) {
+		return (uint64_t(uint32_t(x)) << 32) | uint32_t(y);
+	}
+
+	void cellRange(const Box &box, int &x1, int &y1, int &x2, int &y2) const {
+		x1 = int(std::floor(box.min.x / this->cellSize));
+		y1 = int(std::floor(box.min.y / this->cellSize));
+		x2 = int(std::floor(box.max.x / this->cellSize));
+		y2 = int(std::floor(box.max.y / this->cellSize));
+	}
+
+	double cellSize;
+	std::vector<Box> boxes;
+	std::vector<int> large;
+	std::unordered_map<uint64_t, std::vector<int>> cells;
+};
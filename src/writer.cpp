@@ -0,0 +1,35 @@
+#include "writer.hpp"
+#include <fstream>
+#include <iostream>
+
+
+FileWriter::FileWriter(size_t capacity) : queue(capacity) {
+	this->thread = std::thread([this] {
+		File file;
+		while (this->queue.pop(file))
+			writeNow(file);
+	});
+	active = this;
+}
+
+FileWriter::~FileWriter() {
+	active = nullptr;
+	this->queue.close();
+	this->thread.join();
+}
+
+void FileWriter::write(const std::filesystem::path &path, std::string data) {
+	File file{path, std::move(data)};
+	if (active != nullptr)
+		active->queue.push(std::move(file));
+	else
+		writeNow(file);
+}
+
+void FileWriter::writeNow(const File &file) {
+	std::ofstream f(file.path.string());
+	f.write(file.data.data(), file.data.size());
+	f.close();
+	if (!f)
+		std::cerr << "error: could not write " << file.path.string() << std::endl;
+}
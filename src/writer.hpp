@@ -0,0 +1,33 @@
+#pragma once
+
+#include "queue.hpp"
+#include <filesystem>
+#include <string>
+#include <thread>
+
+
+// writes output files on a background thread so that generation does not wait for the file system. Only one writer
+// can be active at a time, without active writer the files get written directly
+class FileWriter {
+public:
+	// capacity is the number of files that can be pending before generation waits for the writer
+	explicit FileWriter(size_t capacity = 64);
+
+	// writes the pending files and stops the thread
+	~FileWriter();
+
+	// write data to a file using the active writer
+	static void write(const std::filesystem::path &path, std::string data);
+
+private:
+	struct File {
+		std::filesystem::path path;
+		std::string data;
+	};
+
+	static void writeNow(const File &file);
+
+	BoundedQueue<File> queue;
+	std::thread thread;
+	inline static FileWriter *active = nullptr;
+};